@@ -3,12 +3,13 @@
 #include <c++11Helpers.h>
 #include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <string_view>
 #include <vector>
 #include <visibility.h>
 
 namespace IceSpider {
-	using PathElements = std::vector<std::string_view>;
+	using PathElements = std::pmr::vector<std::string_view>;
 
 	class DLL_PUBLIC PathPart {
 	public:
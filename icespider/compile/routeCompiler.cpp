@@ -9,21 +9,27 @@
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/format.hpp>
+#include <cctype>
 #include <compileTimeFormatter.h>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <fprintbf.h>
 #include <http.h>
 #include <initializer_list>
+#include <map>
 #include <memory>
 #include <pathparts.h>
 #include <scopeExit.h>
+#include <set>
 #include <slicer/modelPartsTypes.h>
 #include <slicer/serializer.h>
 #include <slicer/slicer.h>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace IceSpider::Compile {
 	namespace {
@@ -33,6 +39,36 @@ namespace IceSpider::Compile {
 			target.emplace_back(std::move(value));
 			return target;
 		}
+
+		// value as the body of a C++ string literal; path literals come from route config and may contain anything
+		std::string
+		escapeLiteral(const std::string_view value)
+		{
+			std::string escaped;
+			escaped.reserve(value.length());
+			for (const auto chr : value) {
+				switch (chr) {
+					case '"':
+					case '\\':
+						escaped += '\\';
+						escaped += chr;
+						break;
+					default:
+						if (std::isprint(static_cast<unsigned char>(chr))) {
+							escaped += chr;
+						}
+						else {
+							// Octal escapes stop after three digits, so can't swallow what follows
+							escaped += "\\000";
+							const auto code = static_cast<unsigned char>(chr);
+							escaped[escaped.length() - 3] = static_cast<char>('0' + ((code >> 6U) & 7U));
+							escaped[escaped.length() - 2] = static_cast<char>('0' + ((code >> 3U) & 7U));
+							escaped[escaped.length() - 1] = static_cast<char>('0' + (code & 7U));
+						}
+				}
+			}
+			return escaped;
+		}
 	}
 
 	using namespace AdHoc::literals;
@@ -295,11 +331,349 @@ namespace IceSpider::Compile {
 
 		AdHocFormatter(MimePair, R"C({ "%?", "%?" })C");
 
+		std::string
+		mimePair(const std::string_view mimeType)
+		{
+			auto slash = mimeType.find('/');
+			return MimePair::get(mimeType.substr(0, slash), mimeType.substr(slash + 1));
+		}
+
 		std::string
 		outputSerializerMime(const IceSpider::OutputSerializers::value_type & outputSerializer)
 		{
-			auto slash = outputSerializer.first.find('/');
-			return MimePair::get(outputSerializer.first.substr(0, slash), outputSerializer.first.substr(slash + 1));
+			return mimePair(outputSerializer.first);
+		}
+
+		constexpr std::string_view MD_CPP_TYPE {"cpp:type:"};
+		constexpr std::string_view MD_CPP_ARRAY {"cpp:array"};
+		constexpr std::string_view MD_CPP_RANGE {"cpp:range"};
+		constexpr std::string_view MD_SLICER {"slicer:"};
+		constexpr std::string_view MD_SLICER_IGNORE {"slicer:ignore"};
+		constexpr std::string_view MD_SLICER_NAME {"slicer:name:"};
+		constexpr std::string_view MD_SLICER_JSON_NAME {"slicer:json:name:"};
+		constexpr std::string_view MD_SLICER_JSON_OBJECT {"slicer:json:object"};
+
+		std::optional<std::string_view>
+		metadataValue(const Slice::StringList & metadata, const std::string_view prefix)
+		{
+			for (const std::string_view item : metadata) {
+				if (item.starts_with(prefix)) {
+					return item.substr(prefix.length());
+				}
+			}
+			return std::nullopt;
+		}
+
+		bool
+		metadataFlag(const Slice::StringList & metadata, const std::string_view flag)
+		{
+			return std::ranges::find(metadata, flag) != metadata.end();
+		}
+
+		// Metadata the typed JSON writers honour; anything else changing the C++ type, or what slicer would write,
+		// leaves the whole type to slicer
+		bool
+		jsonWriterMetadata(const Slice::StringList & metadata)
+		{
+			return std::ranges::all_of(metadata, [](const std::string_view item) {
+				if (item.starts_with(MD_CPP_TYPE) || item.starts_with(MD_CPP_ARRAY) || item.starts_with(MD_CPP_RANGE)) {
+					return false;
+				}
+				if (item.starts_with(MD_SLICER)) {
+					return item == MD_SLICER_IGNORE || item == MD_SLICER_JSON_OBJECT || item.starts_with(MD_SLICER_NAME)
+							|| item.starts_with(MD_SLICER_JSON_NAME);
+				}
+				return true;
+			});
+		}
+
+		bool
+		isSimple(const Slice::BuiltinPtr & builtin)
+		{
+			switch (builtin->kind()) {
+				case Slice::Builtin::KindBool:
+				case Slice::Builtin::KindByte:
+				case Slice::Builtin::KindShort:
+				case Slice::Builtin::KindInt:
+				case Slice::Builtin::KindLong:
+				case Slice::Builtin::KindFloat:
+				case Slice::Builtin::KindDouble:
+				case Slice::Builtin::KindString:
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		// Whether all of type can be written by generated code
+		bool
+		// NOLINTNEXTLINE(misc-no-recursion)
+		jsonWritable(const Slice::TypePtr & type, std::set<std::string> & visiting)
+		{
+			if (const auto builtin = Slice::BuiltinPtr::dynamicCast(type)) {
+				return isSimple(builtin);
+			}
+			const auto contained = Slice::ContainedPtr::dynamicCast(type);
+			if (!contained || !jsonWriterMetadata(contained->getMetaData())) {
+				return false;
+			}
+			if (!visiting.insert(contained->scoped()).second) {
+				// Recursive; decided by the outer call
+				return true;
+			}
+			const auto membersWritable = [&visiting](const Slice::DataMemberList & members) {
+				return std::ranges::all_of(members, [&visiting](const Slice::DataMemberPtr & member) {
+					return jsonWriterMetadata(member->getMetaData()) && jsonWritable(member->type(), visiting);
+				});
+			};
+			if (const auto strct = Slice::StructPtr::dynamicCast(type)) {
+				return membersWritable(strct->dataMembers());
+			}
+			if (const auto cls = Slice::ClassDeclPtr::dynamicCast(type)) {
+				const auto definition = cls->definition();
+				return definition && !cls->isInterface() && membersWritable(definition->allDataMembers());
+			}
+			if (const auto sequence = Slice::SequencePtr::dynamicCast(type)) {
+				return jsonWritable(sequence->type(), visiting);
+			}
+			if (const auto dictionary = Slice::DictionaryPtr::dynamicCast(type)) {
+				if (metadataFlag(dictionary->getMetaData(), MD_SLICER_JSON_OBJECT)) {
+					const auto keyBuiltin = Slice::BuiltinPtr::dynamicCast(dictionary->keyType());
+					if (!(keyBuiltin && isSimple(keyBuiltin)) && !Slice::EnumPtr::dynamicCast(dictionary->keyType())) {
+						return false;
+					}
+				}
+				return jsonWritable(dictionary->keyType(), visiting) && jsonWritable(dictionary->valueType(), visiting);
+			}
+			return static_cast<bool>(Slice::EnumPtr::dynamicCast(type));
+		}
+
+		std::string
+		jsonWriterName(const Slice::TypePtr & type)
+		{
+			if (const auto builtin = Slice::BuiltinPtr::dynamicCast(type)) {
+				return "_jw_" + builtin->kindAsString();
+			}
+			return "_jw_"
+					+ boost::algorithm::replace_all_copy(
+							Slice::ContainedPtr::dynamicCast(type)->scoped().substr(2), "::", "_");
+		}
+
+		// Adds a writer for type and every constructed type within it; simple values are written inline
+		void
+		// NOLINTNEXTLINE(misc-no-recursion)
+		collectJsonWriters(const Slice::TypePtr & type, std::map<std::string, Slice::TypePtr> & writers)
+		{
+			if (!writers.emplace(jsonWriterName(type), type).second) {
+				return;
+			}
+			const auto nested = [&writers](const Slice::TypePtr & nestedType) {
+				if (!Slice::BuiltinPtr::dynamicCast(nestedType)) {
+					collectJsonWriters(nestedType, writers);
+				}
+			};
+			const auto members = [&nested](const Slice::DataMemberList & dataMembers) {
+				for (const auto & member : dataMembers) {
+					if (!metadataFlag(member->getMetaData(), MD_SLICER_IGNORE)) {
+						nested(member->type());
+					}
+				}
+			};
+			if (const auto strct = Slice::StructPtr::dynamicCast(type)) {
+				members(strct->dataMembers());
+			}
+			else if (const auto cls = Slice::ClassDeclPtr::dynamicCast(type)) {
+				members(cls->definition()->allDataMembers());
+			}
+			else if (const auto sequence = Slice::SequencePtr::dynamicCast(type)) {
+				nested(sequence->type());
+			}
+			else if (const auto dictionary = Slice::DictionaryPtr::dynamicCast(type)) {
+				nested(dictionary->keyType());
+				nested(dictionary->valueType());
+			}
+		}
+
+		std::string
+		jsonQuoted(const std::string_view name)
+		{
+			std::string quoted {'"'};
+			for (const auto chr : name) {
+				if (chr == '"' || chr == '\\') {
+					quoted += '\\';
+				}
+				quoted += chr;
+			}
+			quoted += '"';
+			return quoted;
+		}
+
+		void
+		writeJsonValue(unsigned int indent, FILE * output, const Slice::TypePtr & type, const std::string_view expr)
+		{
+			if (Slice::BuiltinPtr::dynamicCast(type)) {
+				fprintbf(indent, output, "IceSpider::JsonStreamSerializer::writeValue(out, %s);\n", expr);
+			}
+			else {
+				fprintbf(indent, output, "%s(out, %s);\n", jsonWriterName(type), expr);
+			}
+		}
+
+		void
+		writeJsonSeparator(unsigned int indent, FILE * output)
+		{
+			fprintbf(indent, output, "if (std::exchange(_more, true)) {\n");
+			fprintbf(indent + 1, output, "out.sputc(',');\n");
+			fprintbf(indent, output, "}\n");
+		}
+
+		void
+		writeJsonRaw(unsigned int indent, FILE * output, const std::string_view json)
+		{
+			fprintbf(indent, output, "IceSpider::JsonStreamSerializer::writeRaw(out, R\"J(%s)J\");\n", json);
+		}
+
+		// Members which are unset (optionals) or null (classes) are left out, as slicer does. Whether a separator is
+		// needed is known here until the first of those; after it, until the next member which is always written,
+		// it's tracked at runtime.
+		void
+		writeJsonMembers(FILE * output, const Slice::DataMemberList & members, const std::string_view access)
+		{
+			enum class Written : uint8_t { Nothing, Something, Unknown };
+			auto written = Written::Nothing;
+			fprintbf(3, output, "out.sputc('{');\n");
+			if (std::ranges::any_of(members, [](const Slice::DataMemberPtr & member) {
+					return member->optional() || static_cast<bool>(Slice::ClassDeclPtr::dynamicCast(member->type()));
+				})) {
+				fprintbf(3, output, "[[maybe_unused]] bool _more = false;\n");
+			}
+			for (const auto & member : members) {
+				const auto & metadata = member->getMetaData();
+				if (metadataFlag(metadata, MD_SLICER_IGNORE)) {
+					continue;
+				}
+				const std::string name {metadataValue(metadata, MD_SLICER_JSON_NAME)
+												.or_else([&metadata]() {
+													return metadataValue(metadata, MD_SLICER_NAME);
+												})
+												.value_or(member->name())};
+				const auto expr = "value" + std::string {access} + Slice::fixKwd(member->name());
+				const auto isClass = static_cast<bool>(Slice::ClassDeclPtr::dynamicCast(member->type()));
+				const bool conditional = member->optional() || isClass;
+				auto indent = 3U;
+				if (member->optional() && isClass) {
+					fprintbf(indent++, output, "if (%s && *%s) {\n", expr, expr);
+				}
+				else if (conditional) {
+					fprintbf(indent++, output, "if (%s) {\n", expr);
+				}
+				if (written == Written::Unknown) {
+					writeJsonSeparator(indent, output);
+				}
+				writeJsonRaw(indent, output, (written == Written::Something ? "," : "") + jsonQuoted(name) + ":");
+				if (conditional && written == Written::Nothing) {
+					fprintbf(indent, output, "_more = true;\n");
+				}
+				writeJsonValue(indent, output, member->type(), member->optional() ? "*" + expr : expr);
+				if (conditional) {
+					fprintbf(3, output, "}\n");
+				}
+				if (!conditional) {
+					written = Written::Something;
+				}
+				else if (written == Written::Nothing) {
+					written = Written::Unknown;
+				}
+			}
+			fprintbf(3, output, "out.sputc('}');\n");
+		}
+
+		void
+		defineJsonWriter(FILE * output, const std::string & name, const Slice::TypePtr & type)
+		{
+			fprintbf(2, output, "void\n");
+			fprintbf(2, output, "%s(std::streambuf & out, const %s & value)\n", name, Slice::typeToString(type));
+			fprintbf(2, output, "{\n");
+			if (Slice::BuiltinPtr::dynamicCast(type)) {
+				writeJsonValue(3, output, type, "value");
+			}
+			else if (const auto strct = Slice::StructPtr::dynamicCast(type)) {
+				writeJsonMembers(output, strct->dataMembers(), ".");
+			}
+			else if (const auto cls = Slice::ClassDeclPtr::dynamicCast(type)) {
+				fprintbf(3, output, "if (!value) {\n");
+				writeJsonRaw(4, output, "null");
+				fprintbf(4, output, "return;\n");
+				fprintbf(3, output, "}\n");
+				fprintbf(3, output, "if (typeid(*value) != typeid(%s)) {\n", cls->scoped());
+				fprintbf(4, output, "// Subclasses are written with their type id\n");
+				fprintbf(4, output, "IceSpider::JsonStreamSerializer::writeModel(out, value);\n");
+				fprintbf(4, output, "return;\n");
+				fprintbf(3, output, "}\n");
+				writeJsonMembers(output, cls->definition()->allDataMembers(), "->");
+			}
+			else if (const auto sequence = Slice::SequencePtr::dynamicCast(type)) {
+				fprintbf(3, output, "out.sputc('[');\n");
+				fprintbf(3, output, "bool _more = false;\n");
+				fprintbf(3, output, "for (const auto & _e : value) {\n");
+				writeJsonSeparator(4, output);
+				writeJsonValue(4, output, sequence->type(), "_e");
+				fprintbf(3, output, "}\n");
+				fprintbf(3, output, "out.sputc(']');\n");
+			}
+			else if (const auto dictionary = Slice::DictionaryPtr::dynamicCast(type)) {
+				const bool asObject = metadataFlag(dictionary->getMetaData(), MD_SLICER_JSON_OBJECT);
+				fprintbf(3, output, "out.sputc('%c');\n", asObject ? '{' : '[');
+				fprintbf(3, output, "bool _more = false;\n");
+				fprintbf(3, output, "for (const auto & [_k, _v] : value) {\n");
+				writeJsonSeparator(4, output);
+				if (asObject) {
+					if (Slice::BuiltinPtr::dynamicCast(dictionary->keyType())) {
+						fprintbf(4, output, "IceSpider::JsonStreamSerializer::writeKey(out, _k);\n");
+					}
+					else {
+						writeJsonValue(4, output, dictionary->keyType(), "_k");
+					}
+					fprintbf(4, output, "out.sputc(':');\n");
+					writeJsonValue(4, output, dictionary->valueType(), "_v");
+				}
+				else {
+					writeJsonRaw(4, output, R"({"key":)");
+					writeJsonValue(4, output, dictionary->keyType(), "_k");
+					const auto classValue
+							= static_cast<bool>(Slice::ClassDeclPtr::dynamicCast(dictionary->valueType()));
+					auto indent = 4U;
+					if (classValue) {
+						fprintbf(indent++, output, "if (_v) {\n");
+					}
+					writeJsonRaw(indent, output, R"(,"value":)");
+					writeJsonValue(indent, output, dictionary->valueType(), "_v");
+					if (classValue) {
+						fprintbf(4, output, "}\n");
+					}
+					fprintbf(4, output, "out.sputc('}');\n");
+				}
+				fprintbf(3, output, "}\n");
+				fprintbf(3, output, "out.sputc('%c');\n", asObject ? '}' : ']');
+			}
+			else {
+				fprintbf(3, output,
+						"IceSpider::JsonStreamSerializer::writeString(out, "
+						"Slicer::ModelPartForEnum<%s>::lookup(value));\n",
+						Slice::typeToString(type));
+			}
+			fprintbf(2, output, "}\n\n");
+		}
+
+		void
+		addResponse(unsigned int indent, FILE * output, const std::string_view jsonWriter)
+		{
+			if (jsonWriter.empty()) {
+				fprintbf(indent, output, "request->response(this, _responseModel);\n");
+			}
+			else {
+				fprintbf(indent, output, "request->response(this, _responseModel, &%s);\n", jsonWriter);
+			}
 		}
 
 		void
@@ -345,6 +719,9 @@ namespace IceSpider::Compile {
 			}
 			fputs("));\n", output);
 		}
+		if (route->defaultContentType) {
+			fprintbf(4, output, "setDefaultContentType(%s);\n", mimePair(*route->defaultContentType));
+		}
 	}
 
 	void
@@ -383,6 +760,7 @@ namespace IceSpider::Compile {
 					 "Ice/Config.h",
 					 "Ice/Exception.h",
 					 "Ice/Proxy.h",
+					 "exception",
 					 "future",
 					 "ios",
 					 "memory",
@@ -391,11 +769,25 @@ namespace IceSpider::Compile {
 					 "factory.h",
 					 "http.h",
 					 "ihttpRequest.h",
+					 "router.h",
 					 "util.h",
 			 }) {
 			fprintbf(output, "#include <%s>\n", header);
 		}
 
+		if (routeConfig->typedJsonWriters) {
+			fputs("\n// Typed JSON writer headers.\n", output);
+			for (const auto header : {
+						 "jsonStreamSerializer.h",
+						 "slicer/modelPartsTypes.h",
+						 "streambuf",
+						 "typeinfo",
+						 "utility",
+				 }) {
+				fprintbf(output, "#include <%s>\n", header);
+			}
+		}
+
 		if (!routeConfig->headers.empty()) {
 			fputs("\n// Extra headers.\n", output);
 			fputs("\n// Extra headers.\n", outputh);
@@ -462,19 +854,157 @@ namespace IceSpider::Compile {
 	{
 		fputs("\n", output);
 		fprintbf(output, "namespace %s {\n", routeConfig->name);
+		const auto jsonWriters
+				= routeConfig->typedJsonWriters ? processJsonWriters(output, routeConfig, units) : JsonWriters {};
 		fprintbf(1, output, "// Implementation classes.\n\n");
 		for (const auto & route : routeConfig->routes) {
-			processRoute(output, route, units);
+			processRoute(output, route, units, jsonWriters);
 		}
+		processDispatchTable(output, routeConfig);
 		fprintbf(output, "} // namespace %s\n\n", routeConfig->name);
 		fputs("// Register route handlers.\n", output);
 		for (const auto & route : routeConfig->routes) {
 			fprintbf(output, "FACTORY(%s::%s, IceSpider::RouteHandlerFactory);\n", routeConfig->name, route.first);
 		}
+		fputs("// Register dispatch table.\n", output);
+		fprintbf(output, "FACTORY(%s::DispatchTable, IceSpider::RouterFactory);\n", routeConfig->name);
+	}
+
+	RouteCompiler::JsonWriters
+	RouteCompiler::processJsonWriters(FILE * output, const RouteConfigurationPtr & routeConfig, const Units & units)
+	{
+		JsonWriters routeWriters;
+		std::map<std::string, Slice::TypePtr> writers;
+		for (const auto & route : routeConfig->routes) {
+			// Mashups build their model in the route and go through slicer
+			if (!route.second->operation) {
+				continue;
+			}
+			const auto operation = findOperation(*route.second->operation, units);
+			const auto returnType = operation->returnType();
+			if (std::set<std::string> visiting; !returnType || operation->returnIsOptional()
+					|| !jsonWriterMetadata(operation->getMetaData()) || !jsonWritable(returnType, visiting)) {
+				continue;
+			}
+			collectJsonWriters(returnType, writers);
+			routeWriters.emplace(route.first, jsonWriterName(returnType));
+		}
+		if (!writers.empty()) {
+			fprintbf(1, output, "// Typed JSON writers.\n");
+			fprintbf(1, output, "namespace {\n");
+			for (const auto & [name, type] : writers) {
+				fprintbf(2, output, "void %s(std::streambuf &, const %s &);\n", name, Slice::typeToString(type));
+			}
+			fputs("\n", output);
+			for (const auto & [name, type] : writers) {
+				defineJsonWriter(output, name, type);
+			}
+			fprintbf(1, output, "}\n\n");
+		}
+		return routeWriters;
 	}
 
 	void
-	RouteCompiler::processRoute(FILE * output, const Routes::value_type & route, const Units & units)
+	RouteCompiler::processDispatchTable(FILE * output, const RouteConfigurationPtr & routeConfig)
+	{
+		// Routes are considered in path order, as Core::allRoutes is, so the generated
+		// table resolves overlapping paths the same way as the runtime routers.
+		std::vector<std::pair<std::string, RoutePtr>> routes {routeConfig->routes.begin(), routeConfig->routes.end()};
+		std::ranges::stable_sort(routes, {}, [](const auto & route) {
+			return std::string_view {route.second->path};
+		});
+		using LiteralChecks = std::vector<std::pair<std::size_t, std::string_view>>;
+		using MethodRoutes = std::vector<std::pair<std::string, std::string>>;
+
+		struct DispatchGroup {
+			LiteralChecks checks;
+			MethodRoutes routes;
+		};
+
+		std::map<std::size_t, std::vector<DispatchGroup>> lengthGroups;
+		for (const auto & route : routes) {
+			const Path path {route.second->path};
+			LiteralChecks checks;
+			for (const auto & part : path.parts) {
+				if (const auto * literal = dynamic_cast<const PathLiteral *>(part.get())) {
+					checks.emplace_back(static_cast<std::size_t>(&part - &path.parts.front()), literal->value);
+				}
+			}
+			// Consecutive routes with the same literals share a single test
+			auto & groups = lengthGroups[path.pathElementCount()];
+			if (groups.empty() || groups.back().checks != checks) {
+				groups.push_back({.checks = std::move(checks), .routes = {}});
+			}
+			groups.back().routes.emplace_back(route.first, getEnumString(route.second->method));
+		}
+
+		fprintbf(1, output, "// Dispatch table.\n");
+		fprintbf(1, output, "class DispatchTable : public IceSpider::Router {\n");
+		fprintbf(2, output, "public:\n");
+		fprintbf(3, output, "explicit DispatchTable(const IceSpider::Core * core)");
+		for (const auto & route : routes) {
+			fputs(&route == &routes.front() ? " :\n" : ",\n", output);
+			fprintbf(4, output, "_r_%s(core->getRoute<%s>())", route.first, route.first);
+		}
+		fputs("\n", output);
+		fprintbf(3, output, "{\n");
+		fprintbf(3, output, "}\n\n");
+		fprintbf(3, output, "const IceSpider::IRouteHandler *\n");
+		fprintbf(3, output,
+				"findRoute([[maybe_unused]] const IceSpider::PathElements & path, [[maybe_unused]] "
+				"IceSpider::HttpMethod method, [[maybe_unused]] bool & pathMatched) const override\n");
+		fprintbf(3, output, "{\n");
+		if (!lengthGroups.empty()) {
+			fprintbf(4, output, "switch (path.size()) {\n");
+			for (const auto & [length, groups] : lengthGroups) {
+				fprintbf(5, output, "case %u: {\n", length);
+				for (const auto & group : groups) {
+					auto indent = 6U;
+					if (!group.checks.empty()) {
+						fprintbf(indent++, output, "if (");
+						bool first = true;
+						for (const auto & [idx, literal] : group.checks) {
+							if (!std::exchange(first, false)) {
+								fputs(" && ", output);
+							}
+							fprintbf(output, "path[%u] == \"%s\"", idx, escapeLiteral(literal));
+						}
+						fputs(") {\n", output);
+					}
+					fprintbf(indent, output, "pathMatched = true;\n");
+					fprintbf(indent, output, "switch (method) {\n");
+					std::set<std::string_view> methods;
+					for (const auto & [name, method] : group.routes) {
+						// A later route with the same path and method could never be reached
+						if (methods.insert(method).second) {
+							fprintbf(indent + 1, output, "case IceSpider::HttpMethod::%s:\n", method);
+							fprintbf(indent + 2, output, "return _r_%s;\n", name);
+						}
+					}
+					fprintbf(indent + 1, output, "default:\n");
+					fprintbf(indent + 2, output, "break;\n");
+					fprintbf(indent, output, "}\n");
+					if (!group.checks.empty()) {
+						fprintbf(--indent, output, "}\n");
+					}
+				}
+				fprintbf(6, output, "break;\n");
+				fprintbf(5, output, "}\n");
+			}
+			fprintbf(4, output, "}\n");
+		}
+		fprintbf(4, output, "return nullptr;\n");
+		fprintbf(3, output, "}\n\n");
+		fprintbf(2, output, "private:\n");
+		for (const auto & route : routes) {
+			fprintbf(3, output, "const IceSpider::IRouteHandler * const _r_%s;\n", route.first);
+		}
+		fprintbf(1, output, "};\n\n");
+	}
+
+	void
+	RouteCompiler::processRoute(
+			FILE * output, const Routes::value_type & route, const Units & units, const JsonWriters & jsonWriters)
 	{
 		std::string methodName = getEnumString(route.second->method);
 
@@ -488,7 +1018,7 @@ namespace IceSpider::Compile {
 		fputs(" {\n", output);
 		fprintbf(2, output, "public:\n");
 		fprintbf(3, output, "explicit %s(const IceSpider::Core * core) :\n", route.first);
-		fprintbf(4, output, "IceSpider::IRouteHandler(IceSpider::HttpMethod::%s, \"%s\")", methodName,
+		fprintbf(4, output, "IceSpider::IRouteHandler(core, IceSpider::HttpMethod::%s, \"%s\")", methodName,
 				route.second->path);
 		for (const auto & base : route.second->bases) {
 			fputs(",\n", output);
@@ -502,35 +1032,21 @@ namespace IceSpider::Compile {
 		fprintbf(3, output, "void execute(IceSpider::IHttpRequest * request) const override\n");
 		fprintbf(3, output, "{\n");
 		auto parameters = findParameters(route.second, units);
-		bool doneBody = false;
-		for (const auto & param : route.second->params) {
-			if (param.second->hasUserSource) {
-				auto iceParamDecl = parameters.find(param.first)->second;
-				const auto paramType
-						= Slice::typeToString(iceParamDecl->type(), false, "", iceParamDecl->getMetaData());
-				if (param.second->source == ParameterSource::Body) {
-					processParameterSourceBody(output, param, doneBody, paramType);
-				}
-				else {
-					fprintbf(4, output, "const auto _p_%s(request->get%sParam<%s>(_p%c_%s)", param.first,
-							getEnumString(param.second->source), paramType,
-							param.second->source == ParameterSource::URL ? 'i' : 'n', param.first);
-				}
-				if (!param.second->isOptional && param.second->source != ParameterSource::URL) {
-					fprintbf(0, output, " /\n");
-					if (param.second->defaultExpr) {
-						fprintbf(5, output, " [this]() { return _pd_%s; }", param.first);
-					}
-					else {
-						fprintbf(5, output, " [this]() { return requiredParameterNotFound<%s>(\"%s\", _pn_%s); }",
-								paramType, getEnumString(param.second->source), param.first);
-					}
-				}
-				fprintbf(0, output, ");\n");
-			}
-		}
+		addParameters(output, route.second, parameters);
 		if (route.second->operation) {
-			addSingleOperation(output, route.second, findOperation(*route.second->operation, units));
+			const auto operation = findOperation(*route.second->operation, units);
+			const auto jsonWriter = jsonWriters.find(route.first);
+			const std::string_view writer
+					= jsonWriter != jsonWriters.end() ? std::string_view {jsonWriter->second} : std::string_view {};
+			addSingleOperation(output, route.second, operation, writer);
+			fprintbf(3, output, "}\n\n");
+			// Mashups use the default, synchronous, executeAsync
+			fprintbf(3, output,
+					"void executeAsync(IceSpider::IHttpRequest * request, IceSpider::IRouteHandler::Completion "
+					"completion) const override\n");
+			fprintbf(3, output, "{\n");
+			addParameters(output, route.second, parameters);
+			addSingleOperationAsync(output, route.second, operation, writer);
 		}
 		else {
 			addMashupOperations(output, route.second, proxies, units);
@@ -569,6 +1085,38 @@ namespace IceSpider::Compile {
 		fprintbf(1, output, "};\n\n");
 	}
 
+	void
+	RouteCompiler::addParameters(FILE * output, const RoutePtr & route, const ParameterMap & parameters)
+	{
+		bool doneBody = false;
+		for (const auto & param : route->params) {
+			if (param.second->hasUserSource) {
+				auto iceParamDecl = parameters.find(param.first)->second;
+				const auto paramType
+						= Slice::typeToString(iceParamDecl->type(), false, "", iceParamDecl->getMetaData());
+				if (param.second->source == ParameterSource::Body) {
+					processParameterSourceBody(output, param, doneBody, paramType);
+				}
+				else {
+					fprintbf(4, output, "const auto _p_%s(request->get%sParam<%s>(_p%c_%s)", param.first,
+							getEnumString(param.second->source), paramType,
+							param.second->source == ParameterSource::URL ? 'i' : 'n', param.first);
+				}
+				if (!param.second->isOptional && param.second->source != ParameterSource::URL) {
+					fprintbf(0, output, " /\n");
+					if (param.second->defaultExpr) {
+						fprintbf(5, output, " [this]() { return _pd_%s; }", param.first);
+					}
+					else {
+						fprintbf(5, output, " [this]() { return requiredParameterNotFound<%s>(\"%s\", _pn_%s); }",
+								paramType, getEnumString(param.second->source), param.first);
+					}
+				}
+				fprintbf(0, output, ");\n");
+			}
+		}
+	}
+
 	RouteCompiler::Proxies
 	RouteCompiler::initializeProxies(FILE * output, const RoutePtr & route)
 	{
@@ -597,7 +1145,8 @@ namespace IceSpider::Compile {
 	}
 
 	void
-	RouteCompiler::addSingleOperation(FILE * output, const RoutePtr & route, const Slice::OperationPtr & operation)
+	RouteCompiler::addSingleOperation(FILE * output, const RoutePtr & route, const Slice::OperationPtr & operation,
+			const std::string_view jsonWriter)
 	{
 		if (auto operationName = route->operation->substr(route->operation->find_last_of('.') + 1);
 				operation->returnType()) {
@@ -606,27 +1155,66 @@ namespace IceSpider::Compile {
 		else {
 			fprintbf(4, output, "prx0->%s(", operationName);
 		}
-		for (const auto & parameter : operation->parameters()) {
-			auto routeParam = *route->params.find(parameter->name());
-			if (routeParam.second->hasUserSource) {
-				fprintbf(output, "_p_%s, ", parameter->name());
-			}
-			else {
-				fprintbf(output, "_pd_%s, ", parameter->name());
-			}
-		}
+		addOperationArguments(output, route, operation);
 		fprintbf(output, "request->getContext());\n");
 		for (const auto & mutator : route->mutators) {
 			fprintbf(4, output, "%s(request, _responseModel);\n", mutator);
 		}
 		if (operation->returnType()) {
-			fprintbf(4, output, "request->response(this, _responseModel);\n");
+			addResponse(4, output, jsonWriter);
 		}
 		else {
 			fprintbf(4, output, "request->response(200, \"OK\");\n");
 		}
 	}
 
+	void
+	RouteCompiler::addSingleOperationAsync(FILE * output, const RoutePtr & route,
+			const Slice::OperationPtr & operation, const std::string_view jsonWriter)
+	{
+		fprintbf(4, output, "prx0->%sAsync(", route->operation->substr(route->operation->find_last_of('.') + 1));
+		addOperationArguments(output, route, operation);
+		fputs("\n", output);
+		if (operation->returnType()) {
+			fprintbf(6, output, "[this, request, completion](auto _responseModel) {\n");
+		}
+		else {
+			fprintbf(6, output, "[request, completion]() {\n");
+		}
+		fprintbf(7, output, "try {\n");
+		for (const auto & mutator : route->mutators) {
+			fprintbf(8, output, "%s(request, _responseModel);\n", mutator);
+		}
+		if (operation->returnType()) {
+			addResponse(8, output, jsonWriter);
+		}
+		else {
+			fprintbf(8, output, "request->response(200, \"OK\");\n");
+		}
+		fprintbf(7, output, "}\n");
+		fprintbf(7, output, "catch (...) {\n");
+		fprintbf(8, output, "completion(std::current_exception());\n");
+		fprintbf(8, output, "return;\n");
+		fprintbf(7, output, "}\n");
+		fprintbf(7, output, "completion(nullptr);\n");
+		fprintbf(6, output, "},\n");
+		fprintbf(6, output, "completion, nullptr, request->getContext());\n");
+	}
+
+	void
+	RouteCompiler::addOperationArguments(FILE * output, const RoutePtr & route, const Slice::OperationPtr & operation)
+	{
+		for (const auto & parameter : operation->parameters()) {
+			auto routeParam = *route->params.find(parameter->name());
+			if (routeParam.second->hasUserSource) {
+				fprintbf(output, "_p_%s, ", parameter->name());
+			}
+			else {
+				fprintbf(output, "_pd_%s, ", parameter->name());
+			}
+		}
+	}
+
 	void
 	RouteCompiler::addMashupOperations(
 			FILE * output, const RoutePtr & route, const Proxies & proxies, const Units & units)
@@ -8,6 +8,7 @@
 #include <optional>
 #include <routes.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <visibility.h>
 
@@ -28,6 +29,8 @@ namespace IceSpider::Compile {
 
 	private:
 		using Proxies = std::map<std::string, int>;
+		// Route name to the name of its return type's generated JSON writer
+		using JsonWriters = std::map<std::string, std::string>;
 
 #pragma GCC visibility push(hidden)
 		static void processConfiguration(
@@ -35,14 +38,22 @@ namespace IceSpider::Compile {
 		static void processBases(FILE * output, FILE * outputh, const RouteConfigurationPtr &, const Units &);
 		static void processBase(FILE * output, FILE * outputh, const RouteBases::value_type &, const Units &);
 		static void processRoutes(FILE * output, const RouteConfigurationPtr &, const Units &);
-		static void processRoute(FILE * output, const Routes::value_type &, const Units &);
+		static void processRoute(FILE * output, const Routes::value_type &, const Units &, const JsonWriters &);
+		[[nodiscard]] static JsonWriters processJsonWriters(
+				FILE * output, const RouteConfigurationPtr &, const Units &);
+		static void processDispatchTable(FILE * output, const RouteConfigurationPtr &);
 		static void registerOutputSerializers(FILE * output, const RoutePtr &);
 		[[nodiscard]] static Proxies initializeProxies(FILE * output, const RoutePtr &);
 		static void declareProxies(FILE * output, const Proxies &);
-		static void addSingleOperation(FILE * output, const RoutePtr &, const Slice::OperationPtr &);
+		static void addSingleOperation(
+				FILE * output, const RoutePtr &, const Slice::OperationPtr &, std::string_view jsonWriter);
+		static void addSingleOperationAsync(
+				FILE * output, const RoutePtr &, const Slice::OperationPtr &, std::string_view jsonWriter);
+		static void addOperationArguments(FILE * output, const RoutePtr &, const Slice::OperationPtr &);
 		static void addMashupOperations(FILE * output, const RoutePtr &, const Proxies &, const Units &);
 		using ParameterMap = std::map<std::string, Slice::ParamDeclPtr>;
 		static ParameterMap findParameters(const RoutePtr &, const Units &);
+		static void addParameters(FILE * output, const RoutePtr &, const ParameterMap &);
 		static Slice::OperationPtr findOperation(const std::string &, const Units &);
 		static Slice::OperationPtr findOperation(
 				const std::string &, const Slice::ContainerPtr &, const Ice::StringSeq & = Ice::StringSeq());
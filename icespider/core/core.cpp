@@ -6,19 +6,24 @@
 #include <Ice/PropertiesF.h>
 #include <algorithm>
 #include <compileTimeFormatter.h>
+#include <cstddef>
 #include <cstdlib>
 #include <cxxabi.h>
+#include <exception>
 #include <factory.impl.h>
 #include <filesystem>
+#include <functional>
 #include <http.h>
 #include <iostream>
 #include <pathparts.h>
 #include <set>
 #include <string>
+#include <string_view>
 #include <typeinfo>
 
 INSTANTIATEFACTORY(IceSpider::Plugin, Ice::CommunicatorPtr, Ice::PropertiesPtr);
 INSTANTIATEPLUGINOF(IceSpider::ErrorHandler);
+INSTANTIATEPLUGINOF(IceSpider::Configurator);
 
 namespace IceSpider {
 	const std::filesystem::path Core::DEFAULT_CONFIG("config/ice.properties");
@@ -33,6 +38,19 @@ namespace IceSpider {
 			initData.properties->load(config);
 		}
 		communicator = Ice::initialize(initData);
+		maxBodySize = static_cast<std::size_t>(std::max(0,
+				communicator->getProperties()->getPropertyAsIntWithDefault(
+						"IceSpider.MaxBodySize", static_cast<int>(DEFAULT_MAX_BODY_SIZE))));
+		maxMultipartBodySize = static_cast<std::size_t>(std::max(0,
+				communicator->getProperties()->getPropertyAsIntWithDefault(
+						"IceSpider.MaxMultipartBodySize", static_cast<int>(DEFAULT_MAX_MULTIPART_BODY_SIZE))));
+		for (const auto & configurator : AdHoc::PluginManager::getDefault()->getAll<Configurator>()) {
+			configurator->implementation()->configure(communicator->getProperties());
+		}
+		if (const auto jsonPlugin = communicator->getProperties()->getProperty("IceSpider.JsonSerializer");
+				!jsonPlugin.empty()) {
+			serializers = SerializerTable {jsonPlugin};
+		}
 
 		// Initialize routes
 		for (const auto & routeHandleFactory : AdHoc::PluginManager::getDefault()->getAll<RouteHandlerFactory>()) {
@@ -73,8 +91,60 @@ namespace IceSpider {
 	Core::process(IHttpRequest * request, const IRouteHandler * route) const
 	{
 		try {
+			if (!route && rejectMethod(request)) {
+				return;
+			}
 			(route ? route : findRoute(request))->execute(request);
 		}
+		catch (...) {
+			handleException(request, std::current_exception());
+		}
+	}
+
+	void
+	Core::processAsync(IHttpRequest * request, std::function<void()> done) const
+	{
+		try {
+			if (rejectMethod(request)) {
+				done();
+				return;
+			}
+			// done is copied, not moved: it's still needed below if executeAsync throws
+			findRoute(request)->executeAsync(request, [this, request, done](const std::exception_ptr & exception) {
+				if (exception) {
+					handleException(request, exception);
+				}
+				done();
+			});
+		}
+		catch (...) {
+			handleException(request, std::current_exception());
+			done();
+		}
+	}
+
+	bool
+	Core::rejectMethod(IHttpRequest * request)
+	{
+		if (request->findRequestMethod()) {
+			return false;
+		}
+		if (request->hasRequestMethod()) {
+			request->response(Http405MethodNotAllowed::CODE, Http405MethodNotAllowed::MESSAGE);
+		}
+		else {
+			request->response(Http400BadRequest::CODE, Http400BadRequest::MESSAGE);
+		}
+		return true;
+	}
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	Core::handleException(IHttpRequest * request, const std::exception_ptr & exception) const
+	{
+		try {
+			std::rethrow_exception(exception);
+		}
 		catch (const HttpException & he) {
 			request->response(he.code, he.message);
 		}
@@ -143,6 +213,15 @@ namespace IceSpider {
 		return communicator->propertyToProxy(std::string {type});
 	}
 
+	std::size_t
+	Core::maxBodySizeFor(std::string_view contentType) const
+	{
+		// The media type alone, without parameters such as multipart's boundary
+		contentType = contentType.substr(0, contentType.find(';'));
+		remove_trailing(contentType, ' ');
+		return contentType == MIME::MULTIPART_FORM_DATA ? maxMultipartBodySize : maxBodySize;
+	}
+
 	CoreWithDefaultRouter::CoreWithDefaultRouter(const Ice::StringSeq & opts) : Core(opts)
 	{
 		for (const auto & route : allRoutes) {
@@ -178,4 +257,40 @@ namespace IceSpider {
 		throw Http405MethodNotAllowed();
 	}
 
+	CoreWithTrieRouter::CoreWithTrieRouter(const Ice::StringSeq & opts) : Core(opts)
+	{
+		for (const auto & route : allRoutes) {
+			routes.add(route.get());
+		}
+	}
+
+	const IceSpider::IRouteHandler *
+	CoreWithTrieRouter::findRoute(const IceSpider::IHttpRequest * request) const
+	{
+		return routes.find(request->getRequestPath(), request->getRequestMethod());
+	}
+
+	CoreWithGeneratedRouter::CoreWithGeneratedRouter(const Ice::StringSeq & opts) : Core(opts)
+	{
+		for (const auto & routerFactory : AdHoc::PluginManager::getDefault()->getAll<RouterFactory>()) {
+			routers.push_back(routerFactory->implementation()->create(this));
+		}
+	}
+
+	const IceSpider::IRouteHandler *
+	CoreWithGeneratedRouter::findRoute(const IceSpider::IHttpRequest * request) const
+	{
+		const auto & pathparts = request->getRequestPath();
+		const auto method = request->getRequestMethod();
+		bool pathMatched = false;
+		for (const auto & router : routers) {
+			if (const auto * route = router->findRoute(pathparts, method, pathMatched)) {
+				return route;
+			}
+		}
+		if (!pathMatched) {
+			throw Http404NotFound();
+		}
+		throw Http405MethodNotAllowed();
+	}
 }
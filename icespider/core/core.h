@@ -1,6 +1,9 @@
 #pragma once
 
 #include "irouteHandler.h"
+#include "negotiationCache.h"
+#include "routeTrie.h"
+#include "router.h"
 #include "util.h"
 #include <Ice/BuiltinSequences.h>
 #include <Ice/Communicator.h>
@@ -10,10 +13,14 @@
 #include <Ice/Proxy.h>
 #include <Ice/ProxyF.h>
 #include <c++11Helpers.h>
+#include <cstddef>
 #include <exception>
 #include <factory.h> // IWYU pragma: keep
 #include <filesystem>
+#include <functional>
 #include <plugins.h> // IWYU pragma: keep
+#include <stdexcept>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <visibility.h>
@@ -33,9 +40,26 @@ namespace IceSpider {
 
 		virtual const IRouteHandler * findRoute(const IHttpRequest *) const = 0;
 		void process(IHttpRequest *, const IRouteHandler * = nullptr) const;
+		// As process, but done may be called later from an Ice thread once the route's
+		// calls complete; the request must live until then.
+		void processAsync(IHttpRequest *, std::function<void()> done) const;
 		void handleError(IHttpRequest *, const std::exception &) const;
 
 		[[nodiscard]] Ice::ObjectPrxPtr getProxy(std::string_view type) const;
+		// maxBodySize or maxMultipartBodySize, by the body's Content-Type
+		[[nodiscard]] std::size_t maxBodySizeFor(std::string_view contentType) const;
+
+		template<typename RouteType>
+		[[nodiscard]] const RouteType *
+		getRoute() const
+		{
+			for (const auto & route : allRoutes) {
+				if (const auto * typedRoute = dynamic_cast<const RouteType *>(route.get())) {
+					return typedRoute;
+				}
+			}
+			throw std::out_of_range(std::string {TypeName<RouteType>::str()});
+		}
 
 		template<typename Interface>
 		[[nodiscard]] auto
@@ -47,10 +71,24 @@ namespace IceSpider {
 		AllRoutes allRoutes;
 		Ice::CommunicatorPtr communicator;
 		Ice::ObjectAdapterPtr pluginAdapter;
+		// Serializers registered when this Core started, shared by its routes; IceSpider.JsonSerializer names the
+		// plugin for application/json, if not IceSpider's own
+		SerializerTable serializers;
+		// Serializer choices by route and Accept header, shared by all requests
+		mutable NegotiationCache negotiationCache;
+		// Larger request bodies are refused with 413, up front if they declare their length
+		std::size_t maxBodySize {DEFAULT_MAX_BODY_SIZE};
+		// As maxBodySize, for multipart/form-data bodies, whose larger parts are spooled to files rather than held
+		std::size_t maxMultipartBodySize {DEFAULT_MAX_MULTIPART_BODY_SIZE};
 
 		static const std::filesystem::path DEFAULT_CONFIG;
+		static constexpr std::size_t DEFAULT_MAX_BODY_SIZE = 16UL * 1024UL * 1024UL;
+		static constexpr std::size_t DEFAULT_MAX_MULTIPART_BODY_SIZE = 1024UL * 1024UL * 1024UL;
 
 	private:
+		// Answers a request whose method can't be routed, rather than have findRoute throw for it
+		[[nodiscard]] static bool rejectMethod(IHttpRequest *);
+		void handleException(IHttpRequest *, const std::exception_ptr &) const;
 		static void defaultErrorReport(IHttpRequest * request, const std::exception & exception);
 	};
 
@@ -66,6 +104,26 @@ namespace IceSpider {
 		Routes routes;
 	};
 
+	class DLL_PUBLIC CoreWithTrieRouter : public Core {
+	public:
+		explicit CoreWithTrieRouter(const Ice::StringSeq & = {});
+
+		const IRouteHandler * findRoute(const IHttpRequest *) const override;
+
+		RouteTrie routes;
+	};
+
+	class DLL_PUBLIC CoreWithGeneratedRouter : public Core {
+	public:
+		using Routers = std::vector<RouterCPtr>;
+
+		explicit CoreWithGeneratedRouter(const Ice::StringSeq & = {});
+
+		const IRouteHandler * findRoute(const IHttpRequest *) const override;
+
+		Routers routers;
+	};
+
 	class DLL_PUBLIC Plugin : public virtual Ice::Object { };
 
 	using PluginFactory = AdHoc::Factory<Plugin, Ice::CommunicatorPtr, Ice::PropertiesPtr>;
@@ -82,4 +140,12 @@ namespace IceSpider {
 	};
 
 	using ErrorHandlerPlugin = AdHoc::PluginOf<ErrorHandler>;
+
+	// Applies a Core's properties to something process wide, before the Core creates its routes
+	class DLL_PUBLIC Configurator : public AdHoc::AbstractPluginImplementation {
+	public:
+		virtual void configure(const Ice::PropertiesPtr &) const = 0;
+	};
+
+	using ConfiguratorPlugin = AdHoc::PluginOf<Configurator>;
 }
@@ -11,6 +11,7 @@ namespace IceSpider {
 	DefineHttpEx(Http404NotFound, 404, "Not found");
 	DefineHttpEx(Http405MethodNotAllowed, 405, "Method Not Allowed");
 	DefineHttpEx(Http406NotAcceptable, 406, "Not Acceptable");
+	DefineHttpEx(Http413PayloadTooLarge, 413, "Payload Too Large");
 	DefineHttpEx(Http415UnsupportedMediaType, 415, "Unsupported Media Type");
 	DefineHttpEx(Http500InternalServerError, 500, "Internal Server Error");
 }
@@ -18,6 +18,7 @@ namespace IceSpider {
 	DeclareHttpEx(Http404NotFound);
 	DeclareHttpEx(Http405MethodNotAllowed);
 	DeclareHttpEx(Http406NotAcceptable);
+	DeclareHttpEx(Http413PayloadTooLarge);
 	DeclareHttpEx(Http415UnsupportedMediaType);
 	DeclareHttpEx(Http500InternalServerError);
 }
@@ -2,17 +2,25 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace IceSpider {
-	template<typename K, typename M, typename Comp = std::less<>> class FlatMap : std::vector<std::pair<K, M>> {
+	// Which entries survive when FlatMap::sort finds more than one with the same key
+	enum class DuplicateKeys : uint8_t { KeepAll, KeepFirst, KeepLast };
+
+	template<typename K, typename M, typename Comp = std::less<>, typename Alloc = std::allocator<std::pair<K, M>>>
+	class FlatMap : std::vector<std::pair<K, M>, Alloc> {
 	public:
 		using V = std::pair<K, M>;
-		using S = std::vector<V>;
+		using S = std::vector<V, Alloc>;
+		using allocator_type = Alloc; // NOLINT(readability-identifier-naming) - STL like
 
 	private:
 		template<typename N> struct KeyComp {
@@ -34,7 +42,9 @@ namespace IceSpider {
 	public:
 		FlatMap() = default;
 
-		explicit FlatMap(std::size_t n)
+		explicit FlatMap(const Alloc & alloc) : S(alloc) { }
+
+		explicit FlatMap(std::size_t n, const Alloc & alloc = {}) : S(alloc)
 		{
 			reserve(n);
 		}
@@ -52,6 +62,31 @@ namespace IceSpider {
 			return S::emplace(pos, std::move(key), std::move(mapped));
 		}
 
+		// Bulk building: append entries in any order, then sort once before any lookup
+		void
+		append(K key, M mapped)
+		{
+			S::emplace_back(std::move(key), std::move(mapped));
+		}
+
+		void
+		sort(const DuplicateKeys duplicates = DuplicateKeys::KeepAll)
+		{
+			if (duplicates != DuplicateKeys::KeepFirst) {
+				// Latest first among equal keys, as insert and emplace order them, so find gives the latest
+				std::reverse(S::begin(), S::end());
+			}
+			std::stable_sort(S::begin(), S::end(), [](const V & left, const V & right) {
+				return Comp {}(left.first, right.first);
+			});
+			if (duplicates != DuplicateKeys::KeepAll) {
+				const auto sameKey = [](const V & left, const V & right) {
+					return !Comp {}(left.first, right.first) && !Comp {}(right.first, left.first);
+				};
+				S::erase(std::unique(S::begin(), S::end(), sameKey), S::end());
+			}
+		}
+
 		template<typename N>
 		[[nodiscard]] auto
 		lower_bound(const N & n) const // NOLINT(readability-identifier-naming) - STL like
@@ -111,9 +146,16 @@ namespace IceSpider {
 		using S::cbegin;
 		using S::cend;
 		using S::empty;
+		using S::get_allocator;
 		using S::reserve;
 		using S::size;
 		using iterator = typename S::iterator; // NOLINT(readability-identifier-naming) - STL like
 		using const_iterator = typename S::const_iterator; // NOLINT(readability-identifier-naming) - STL like
 	};
+
+	namespace pmr {
+		// A FlatMap whose storage comes from a memory_resource, such as a request arena
+		template<typename K, typename M, typename Comp = std::less<>>
+		using FlatMap = IceSpider::FlatMap<K, M, Comp, std::pmr::polymorphic_allocator<std::pair<K, M>>>;
+	}
 }
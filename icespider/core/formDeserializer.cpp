@@ -0,0 +1,268 @@
+#include "formDeserializer.h"
+#include "exceptions.h"
+#include "util.h"
+#include <Ice/Config.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <flatMap.h>
+#include <slicer/modelParts.h>
+#include <slicer/serializer.h>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace IceSpider {
+	static constexpr const std::string_view TRUE = "true";
+	static constexpr const std::string_view FALSE = "false";
+	static constexpr const std::string_view KEY = "key";
+	static constexpr const std::string_view VALUE = "value";
+	static constexpr const std::size_t SPOOL_CHUNK = 8UL * 1024UL;
+
+	class SetFromString : public Slicer::ValueSource {
+	public:
+		explicit SetFromString(const std::string_view value, const bool binary = false) : s(value), binary(binary) { }
+
+		void
+		set(bool & target) const override
+		{
+			if (s == TRUE) {
+				target = true;
+			}
+			else if (s == FALSE) {
+				target = false;
+			}
+			else {
+				throw Http400BadRequest();
+			}
+		}
+
+		void
+		set(std::string & target) const override
+		{
+			if (binary) {
+				throw Http415UnsupportedMediaType();
+			}
+			target = s;
+		}
+
+#define SET(T) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void set(T & target) const override \
+	{ \
+		convert(s, target); \
+	}
+
+		SET(Ice::Byte);
+		SET(Ice::Short);
+		SET(Ice::Int);
+		SET(Ice::Long);
+		SET(Ice::Float);
+		SET(Ice::Double);
+#undef SET
+
+	private:
+		const std::string_view s;
+		const bool binary;
+	};
+
+	// Sets an element of a sequence<byte>; nothing else can be populated from raw bytes
+	class SetFromByte : public Slicer::ValueSource {
+	public:
+		explicit SetFromByte(const Ice::Byte value) : b(value) { }
+
+		void
+		set(Ice::Byte & target) const override
+		{
+			target = b;
+		}
+
+#define SET(T) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void set(T &) const override \
+	{ \
+		throw Http400BadRequest(); \
+	}
+
+		SET(bool);
+		SET(Ice::Short);
+		SET(Ice::Int);
+		SET(Ice::Long);
+		SET(Ice::Float);
+		SET(Ice::Double);
+		SET(std::string);
+#undef SET
+
+	private:
+		const Ice::Byte b;
+	};
+
+	// Reads a spooled value straight into a string target, unless it's binary; anything else is converted as if it
+	// were in memory
+	class SetFromSpool : public Slicer::ValueSource {
+	public:
+		explicit SetFromSpool(const FormDeserializer::Field & field) : field(field) { }
+
+		void
+		set(std::string & target) const override
+		{
+			if (field.binary) {
+				throw Http415UnsupportedMediaType();
+			}
+			target = read();
+		}
+
+#define SET(T) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void set(T & target) const override \
+	{ \
+		SetFromString(read()).set(target); \
+	}
+
+		SET(bool);
+		SET(Ice::Byte);
+		SET(Ice::Short);
+		SET(Ice::Int);
+		SET(Ice::Long);
+		SET(Ice::Float);
+		SET(Ice::Double);
+#undef SET
+
+	private:
+		[[nodiscard]] std::string
+		read() const
+		{
+			std::rewind(field.spool);
+			std::string value;
+			value.resize_and_overwrite(field.spooledLength, [this](char * out, const std::size_t length) {
+				return std::fread(out, 1, length, field.spool);
+			});
+			if (value.length() != field.spooledLength) {
+				throw std::system_error(errno, std::generic_category(), "Reading spooled form field");
+			}
+			return value;
+		}
+
+		const FormDeserializer::Field & field;
+	};
+
+	void
+	FormDeserializer::Deserialize(Slicer::ModelPartForRootParam modelPart)
+	{
+		modelPart->Create();
+		modelPart->OnEachChild([this](const auto &, auto child, auto) {
+			switch (child->GetType()) {
+				case Slicer::ModelPartType::Simple:
+				case Slicer::ModelPartType::Sequence:
+					this->deserializeSimple(child);
+					break;
+				case Slicer::ModelPartType::Complex:
+					this->deserializeComplex(child);
+					break;
+				case Slicer::ModelPartType::Dictionary:
+					this->deserializeDictionary(child);
+					break;
+				default:
+					throw IceSpider::Http400BadRequest();
+					break;
+			}
+		});
+		modelPart->Complete();
+	}
+
+	void
+	FormDeserializer::setValue(const Slicer::ModelPartParam modelPart, const Field & field)
+	{
+		if (modelPart->GetType() == Slicer::ModelPartType::Sequence) {
+			setBytes(modelPart, field);
+		}
+		else if (field.spool) {
+			modelPart->SetValue(SetFromSpool(field));
+		}
+		else {
+			modelPart->SetValue(SetFromString(field.value, field.binary));
+		}
+	}
+
+	void
+	FormDeserializer::setBytes(const Slicer::ModelPartParam modelPart, const Field & field)
+	{
+		// Slicer only grows a sequence an element at a time; one handler, built once, takes each byte of a run in turn
+		const char * next {};
+		const Slicer::SubPartHandler appendNext = [&next](Slicer::ModelPartParam element, const Slicer::Metadata &) {
+			element->SetValue(SetFromByte(static_cast<Ice::Byte>(*next++)));
+		};
+		const auto append = [modelPart, &next, &appendNext](const std::string_view bytes) {
+			for (next = bytes.data(); next != bytes.data() + bytes.size();) {
+				modelPart->OnAnonChild(appendNext);
+			}
+		};
+		modelPart->Create();
+		if (field.spool) {
+			// A chunk at a time, rather than the whole part copied to a string first
+			std::rewind(field.spool);
+			std::array<char, SPOOL_CHUNK> chunk {};
+			for (auto remaining = field.spooledLength; remaining > 0;) {
+				const auto got = std::fread(chunk.data(), 1, std::min(remaining, chunk.size()), field.spool);
+				if (got == 0) {
+					throw std::system_error(errno, std::generic_category(), "Reading spooled form field");
+				}
+				append({chunk.data(), got});
+				remaining -= got;
+			}
+		}
+		else {
+			append(field.value);
+		}
+		modelPart->Complete();
+	}
+
+	void
+	FormDeserializer::deserializeSimple(const Slicer::ModelPartParam modelPart)
+	{
+		// As the last of repeated assignments would be
+		if (!fields.empty()) {
+			setValue(modelPart, fields.back());
+		}
+	}
+
+	void
+	FormDeserializer::deserializeComplex(const Slicer::ModelPartParam modelPart)
+	{
+		// Index the fields once, rather than search them for each member
+		FlatMap<std::string_view, const Field *> index(fields.size());
+		for (const auto & field : fields) {
+			index.append(field.name, &field);
+		}
+		index.sort(DuplicateKeys::KeepLast);
+		modelPart->Create();
+		modelPart->OnEachChild([&index](const auto & name, auto child, auto) {
+			if (const auto field = index.find(std::string_view {name}); field != index.end()) {
+				setValue(child, *field->second);
+			}
+		});
+		modelPart->Complete();
+	}
+
+	void
+	FormDeserializer::deserializeDictionary(const Slicer::ModelPartParam modelPart)
+	{
+		for (const auto & field : fields) {
+			modelPart->OnAnonChild([&field](Slicer::ModelPartParam child, const Slicer::Metadata &) {
+				child->OnChild(
+						[&field](Slicer::ModelPartParam keyPart, const Slicer::Metadata &) {
+							keyPart->SetValue(SetFromString(field.name));
+						},
+						KEY);
+				child->OnChild(
+						[&field](Slicer::ModelPartParam valuePart, const Slicer::Metadata &) {
+							setValue(valuePart, field);
+						},
+						VALUE);
+				child->Complete();
+			});
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <slicer/modelParts.h>
+#include <slicer/serializer.h>
+#include <string_view>
+#include <vector>
+
+namespace IceSpider {
+	// Populates a simple value, a complex or a dictionary from the flat list of named fields an HTML form submits
+	class FormDeserializer : public Slicer::Deserializer {
+	public:
+		struct Field {
+			std::string_view name;
+			// The value itself, unless it was spooled to a file
+			std::string_view value;
+			// Declared with a media type other than text, so not to be taken as a string
+			bool binary {};
+			std::FILE * spool {};
+			std::size_t spooledLength {};
+		};
+
+		void Deserialize(Slicer::ModelPartForRootParam modelPart) override;
+
+	protected:
+		// Every field, in input order
+		std::vector<Field> fields;
+
+	private:
+		void deserializeSimple(Slicer::ModelPartParam modelPart);
+		void deserializeComplex(Slicer::ModelPartParam modelPart);
+		void deserializeDictionary(Slicer::ModelPartParam modelPart);
+		static void setValue(Slicer::ModelPartParam modelPart, const Field &);
+		static void setBytes(Slicer::ModelPartParam modelPart, const Field &);
+	};
+}
@@ -1,18 +1,28 @@
 #include "ihttpRequest.h"
+#include "core.h"
 #include "exceptions.h"
 #include "irouteHandler.h"
+#include "jsonStreamSerializer.h"
+#include "negotiationCache.h"
 #include "util.h"
 #include "xwwwFormUrlEncoded.h"
 #include <algorithm>
+#include <charconv>
 #include <compileTimeFormatter.h>
 #include <cstdlib>
 #include <ctime>
 #include <formatters.h>
 #include <http.h>
+#include <memory>
+#include <optional>
+#include <ostream>
 #include <plugins.h>
 #include <slicer/modelParts.h>
 #include <slicer/serializer.h>
+#include <span>
+#include <spanstream>
 #include <stdexcept>
+#include <system_error>
 
 namespace IceSpider {
 	using namespace AdHoc::literals;
@@ -25,15 +35,91 @@ namespace IceSpider {
 		return {};
 	}
 
+	std::optional<HttpMethod>
+	IHttpRequest::findRequestMethod() const
+	{
+		try {
+			return getRequestMethod();
+		}
+		catch (const HttpException &) {
+			return std::nullopt;
+		}
+	}
+
+	bool
+	IHttpRequest::hasRequestMethod() const
+	{
+		return true;
+	}
+
+	OptionalString
+	IHttpRequest::getContentType() const
+	{
+		return getEnvStr(E::CONTENT_TYPE);
+	}
+
+	std::optional<std::size_t>
+	IHttpRequest::getContentLength() const
+	{
+		if (const auto contentLength = getEnvStr(E::CONTENT_LENGTH)) {
+			std::size_t length {};
+			if (const auto result
+					= std::from_chars(contentLength->data(), contentLength->data() + contentLength->length(), length);
+					result.ec == std::errc {} && result.ptr == contentLength->data() + contentLength->length()) {
+				return length;
+			}
+		}
+		return std::nullopt;
+	}
+
+	std::istream &
+	IHttpRequest::getBodyStream() const
+	{
+		if (limitedBodyStream) {
+			return *limitedBodyStream;
+		}
+		if (!body) {
+			const auto length = getContentLength();
+			const auto maxBodySize = core->maxBodySizeFor(getContentType().value_or(std::string_view {}));
+			if (length && *length > maxBodySize) {
+				throw Http413PayloadTooLarge();
+			}
+			if (!length || *length > MAX_BUFFERED_BODY) {
+				limitedBodyStream = std::make_unique<LimitedInputStream>(*getInputStream().rdbuf(),
+						length.value_or(maxBodySize),
+						length ? LimitedStreamBuf::Limit::Length : LimitedStreamBuf::Limit::Ceiling);
+				return *limitedBodyStream;
+			}
+			// A single read, rather than a deserializer pulling a character at a time through the input's buffer
+			body = std::make_unique_for_overwrite<char[]>(*length);
+			auto & input = getInputStream();
+			input.read(body.get(), static_cast<std::streamsize>(*length));
+			bodyLength = static_cast<std::size_t>(input.gcount());
+		}
+		bodyStream.emplace(std::span<const char> {body.get(), bodyLength});
+		return *bodyStream;
+	}
+
 	Slicer::DeserializerPtr
 	IHttpRequest::getDeserializer() const
 	{
+		const auto contentType = getContentType() / []() -> std::string_view {
+			throw Http400BadRequest();
+		};
+		// Deserializers are registered by media type alone; any parameters are for those which want them
+		const auto semicolon = contentType.find(';');
+		auto mediaType = contentType.substr(0, semicolon);
+		remove_trailing(mediaType, ' ');
 		try {
-			return Slicer::StreamDeserializerFactory::createNew(
-					getEnvStr(E::CONTENT_TYPE) / []() -> std::string_view {
-						throw Http400BadRequest();
-					},
-					getInputStream());
+			const auto factory = AdHoc::PluginManager::getDefault()
+										 ->get<Slicer::StreamDeserializerFactory>(mediaType)
+										 ->implementation();
+			if (const auto * const parameterised
+					= dynamic_cast<const ParameterisedDeserializerFactory *>(factory.get())) {
+				return parameterised->create(getBodyStream(),
+						semicolon == std::string_view::npos ? std::string_view {} : contentType.substr(semicolon + 1));
+			}
+			return factory->create(getBodyStream());
 		}
 		catch (const AdHoc::NoSuchPluginException &) {
 			throw Http415UnsupportedMediaType();
@@ -100,27 +186,69 @@ namespace IceSpider {
 		return accepts;
 	}
 
-	ContentTypeSerializer
-	IHttpRequest::getSerializer(const IRouteHandler * handler) const
+	std::optional<NegotiatedSerializer>
+	IHttpRequest::negotiate(const IRouteHandler * handler) const
 	{
 		if (auto acceptHdr = getHeaderParamStr(H::ACCEPT)) {
-			auto accepts = parseAccept(*acceptHdr);
-			auto & strm = getOutputStream();
-			if (accepts.empty()) {
-				throw Http400BadRequest();
+			auto negotiated = core->negotiationCache.find(handler, *acceptHdr);
+			if (!negotiated) {
+				negotiated = negotiateSerializer(handler, *acceptHdr);
+				core->negotiationCache.insert(handler, *acceptHdr, *negotiated);
 			}
-			if (!accepts.front().group && !accepts.front().type) {
-				return handler->defaultSerializer(strm);
+			switch (negotiated->outcome) {
+				case NegotiatedSerializer::Outcome::Matched:
+					return negotiated;
+				case NegotiatedSerializer::Outcome::NotAcceptable:
+					throw Http406NotAcceptable();
+				case NegotiatedSerializer::Outcome::RouteDefault:
+					break;
 			}
-			for (const auto & accept : accepts) {
-				ContentTypeSerializer serializer = handler->getSerializer(accept, strm);
-				if (serializer.second) {
-					return serializer;
-				}
+		}
+		return std::nullopt;
+	}
+
+	ContentTypeSerializer
+	IHttpRequest::getSerializer(const IRouteHandler * handler) const
+	{
+		auto & strm = getOutputStream();
+		if (const auto negotiated = negotiate(handler)) {
+			return {negotiated->contentType, negotiated->factory->create(strm)};
+		}
+		return handler->defaultSerializer(strm);
+	}
+
+	std::streambuf *
+	IHttpRequest::nativeJsonResponse(const IRouteHandler * handler) const
+	{
+		const auto negotiated = negotiate(handler);
+		const auto & factory = negotiated ? negotiated->factory : handler->getDefaultSerializerFactory();
+		if (!dynamic_cast<const JsonStreamSerializer::IceSpiderFactory *>(factory.get())) {
+			return nullptr;
+		}
+		const auto & contentType = negotiated ? negotiated->contentType : handler->getDefaultContentType();
+		setHeader(H::CONTENT_TYPE, MimeTypeFmt::get(contentType.group, contentType.type));
+		response(200, S::OK);
+		return getOutputStream().rdbuf();
+	}
+
+	NegotiatedSerializer
+	IHttpRequest::negotiateSerializer(const IRouteHandler * handler, const std::string_view acceptHdr)
+	{
+		const auto accepts = parseAccept(acceptHdr);
+		if (accepts.empty()) {
+			throw Http400BadRequest();
+		}
+		if (!accepts.front().group && !accepts.front().type) {
+			return {.outcome = NegotiatedSerializer::Outcome::RouteDefault};
+		}
+		for (const auto & accept : accepts) {
+			if (const auto * serializer = handler->findSerializer(accept)) {
+				return {.outcome = NegotiatedSerializer::Outcome::Matched,
+						.contentType = serializer->first,
+						.factory = serializer->second};
 			}
-			throw Http406NotAcceptable();
 		}
-		return handler->defaultSerializer(getOutputStream());
+		return {.outcome = NegotiatedSerializer::Outcome::NotAcceptable};
 	}
 
 	std::string_view
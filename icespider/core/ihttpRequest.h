@@ -1,5 +1,6 @@
 #pragma once
 
+#include "limitedStream.h" // IWYU pragma: keep
 #include "util.h"
 #include <Ice/Current.h>
 #include <boost/lexical_cast.hpp>
@@ -8,10 +9,13 @@
 #include <http.h>
 #include <iosfwd>
 #include <map>
+#include <memory_resource>
+#include <memory>
 #include <optional>
 #include <slicer/modelParts.h>
 #include <slicer/serializer.h>
 #include <slicer/slicer.h>
+#include <spanstream>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -22,6 +26,7 @@
 namespace IceSpider {
 	class Core;
 	class IRouteHandler;
+	struct NegotiatedSerializer;
 
 	struct Accept {
 		std::optional<std::string_view> group, type;
@@ -29,12 +34,21 @@ namespace IceSpider {
 	};
 
 	using Accepted = std::vector<Accept>;
-	using PathElements = std::vector<std::string_view>;
+	using PathElements = std::pmr::vector<std::string_view>;
 	using OptionalString = std::optional<std::string_view>;
 	using ContentTypeSerializer = std::pair<MimeType, Slicer::SerializerPtr>;
 
+	// A deserializer which needs the Content-Type's parameters too, such as multipart's boundary
+	class DLL_PUBLIC ParameterisedDeserializerFactory : public Slicer::StreamDeserializerFactory {
+	public:
+		using Slicer::StreamDeserializerFactory::create;
+		[[nodiscard]] virtual Slicer::DeserializerPtr create(std::istream &, std::string_view parameters) const = 0;
+	};
+
 	class DLL_PUBLIC IHttpRequest {
 	public:
+		static constexpr std::size_t MAX_BUFFERED_BODY = 1024UL * 1024UL;
+
 		explicit IHttpRequest(const Core *);
 		virtual ~IHttpRequest() = default;
 		SPECIAL_MEMBERS_DEFAULT_MOVE_NO_COPY(IHttpRequest);
@@ -43,17 +57,32 @@ namespace IceSpider {
 		[[nodiscard]] virtual const PathElements & getRequestPath() const = 0;
 		[[nodiscard]] virtual PathElements & getRequestPath() = 0;
 		[[nodiscard]] virtual HttpMethod getRequestMethod() const = 0;
+		// Never throws; empty where getRequestMethod would, because the method is missing or not supported
+		[[nodiscard]] virtual std::optional<HttpMethod> findRequestMethod() const;
+		// Whether the request gave a method at all, supported or not
+		[[nodiscard]] virtual bool hasRequestMethod() const;
 
 		[[nodiscard]] std::string_view getURLParamStr(unsigned int) const;
 		[[nodiscard]] virtual OptionalString getQueryStringParamStr(std::string_view) const = 0;
 		[[nodiscard]] virtual OptionalString getHeaderParamStr(std::string_view) const = 0;
 		[[nodiscard]] virtual OptionalString getCookieParamStr(std::string_view) const = 0;
 		[[nodiscard]] virtual OptionalString getEnvStr(std::string_view) const = 0;
+		[[nodiscard]] virtual OptionalString getContentType() const;
+		// Absent if not given, or not a number
+		[[nodiscard]] virtual std::optional<std::size_t> getContentLength() const;
 		[[nodiscard]] virtual bool isSecure() const = 0;
 		[[nodiscard]] static Accepted parseAccept(std::string_view);
+		[[nodiscard]] static NegotiatedSerializer negotiateSerializer(const IRouteHandler *, std::string_view accept);
 		[[nodiscard]] virtual Slicer::DeserializerPtr getDeserializer() const;
 		[[nodiscard]] virtual ContentTypeSerializer getSerializer(const IRouteHandler *) const;
+		// The output buffer, after the status and headers, if content negotiation chose the native JSON serializer;
+		// null otherwise, having written nothing
+		[[nodiscard]] std::streambuf * nativeJsonResponse(const IRouteHandler *) const;
 		[[nodiscard]] virtual std::istream & getInputStream() const = 0;
+		// The request body, read into memory in one go when its length is known and no more than MAX_BUFFERED_BODY,
+		// else read from the input as it's consumed; either way, no more than its length or Core::maxBodySizeFor its
+		// Content-Type
+		[[nodiscard]] std::istream & getBodyStream() const;
 		[[nodiscard]] virtual std::ostream & getOutputStream() const = 0;
 		virtual void setHeader(std::string_view, std::string_view) const = 0;
 
@@ -150,8 +179,35 @@ namespace IceSpider {
 			});
 		}
 
+		// As generated by the route compiler for a route's return type
+		template<typename T>
+		using JsonWriter = void (*)(std::streambuf &, const T &);
+
+		template<typename T>
+		void
+		response(const IRouteHandler * route, const T & value,
+				const std::type_identity_t<JsonWriter<T>> writeJson) const
+		{
+			if (auto * out = nativeJsonResponse(route)) {
+				writeJson(*out, value);
+			}
+			else {
+				response(route, value);
+			}
+		}
+
 		void modelPartResponse(const IRouteHandler * route, Slicer::ModelPartForRootParam) const;
 
 		const Core * core;
+
+	private:
+		// The serializer the request's Accept header chose for route, if it has one which isn't just */*
+		[[nodiscard]] std::optional<NegotiatedSerializer> negotiate(const IRouteHandler *) const;
+
+		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+		mutable std::unique_ptr<char[]> body;
+		mutable std::size_t bodyLength {};
+		mutable std::optional<std::ispanstream> bodyStream;
+		mutable std::unique_ptr<LimitedInputStream> limitedBodyStream;
 	};
 }
@@ -1,8 +1,12 @@
 #include "irouteHandler.h"
+#include "core.h"
 #include "exceptions.h"
 #include "routeOptions.h"
 #include <factory.impl.h>
+#include <algorithm>
+#include <exception>
 #include <formatters.h>
+#include <memory>
 #include <optional>
 #include <pathparts.h>
 #include <string>
@@ -11,48 +15,98 @@
 INSTANTIATEFACTORY(IceSpider::IRouteHandler, const IceSpider::Core *);
 
 namespace IceSpider {
-	static const std::string APPLICATION = "application";
-	static const std::string JSON = "json";
-	static const std::string APPLICATION_JSON = MimeTypeFmt::get(APPLICATION, JSON);
+	namespace {
+		std::shared_ptr<const SerializerTable>
+		registeredSerializers(const Core * core)
+		{
+			if (core) {
+				// Not owned; the Core outlives its routes
+				return {std::shared_ptr<const void> {}, &core->serializers};
+			}
+			return std::make_shared<const SerializerTable>();
+		}
+	}
 
 	const RouteOptions IRouteHandler::DEFAULT_ROUTE_OPTIONS {};
 
 	IRouteHandler::IRouteHandler(HttpMethod method, const std::string_view path) :
-		IRouteHandler(method, path, DEFAULT_ROUTE_OPTIONS)
+		IRouteHandler(nullptr, method, path, DEFAULT_ROUTE_OPTIONS)
 	{
 	}
 
 	IRouteHandler::IRouteHandler(HttpMethod method, const std::string_view path, const RouteOptions & routeOpts) :
-		Path(path), method(method)
+		IRouteHandler(nullptr, method, path, routeOpts)
 	{
-		if (routeOpts.addDefaultSerializers) {
-			auto globalSerializers = AdHoc::PluginManager::getDefault()->getAll<Slicer::StreamSerializerFactory>();
-			for (const auto & serializer : globalSerializers) {
-				auto slash = serializer->name.find('/');
-				routeSerializers.insert(
-						{{.group = serializer->name.substr(0, slash), .type = serializer->name.substr(slash + 1)},
-								serializer->implementation()});
-			}
+	}
+
+	IRouteHandler::IRouteHandler(const Core * core, HttpMethod method, const std::string_view path) :
+		IRouteHandler(core, method, path, DEFAULT_ROUTE_OPTIONS)
+	{
+	}
+
+	IRouteHandler::IRouteHandler(
+			const Core * core, HttpMethod method, const std::string_view path, const RouteOptions & routeOpts) :
+		Path(path), method(method), coreSerializers(registeredSerializers(core)),
+		addDefaultSerializers(routeOpts.addDefaultSerializers)
+	{
+		const auto slash = routeOpts.defaultContentType.find('/');
+		setDefaultContentType({.group = routeOpts.defaultContentType.substr(0, slash),
+				.type = routeOpts.defaultContentType.substr(slash + 1)});
+	}
+
+	void
+	IRouteHandler::executeAsync(IHttpRequest * request, Completion completion) const
+	{
+		try {
+			execute(request);
+		}
+		catch (...) {
+			completion(std::current_exception());
+			return;
 		}
+		completion(nullptr);
 	}
 
-	ContentTypeSerializer
-	IRouteHandler::getSerializer(const Accept & accept, std::ostream & strm) const
+	const SerializerTable::Entry *
+	IRouteHandler::findSerializer(const Accept & accept) const
 	{
-		for (const auto & serializer : routeSerializers) {
-			if ((!accept.group || serializer.first.group == accept.group)
-					&& (!accept.type || serializer.first.type == accept.type)) {
-				return {serializer.first, serializer.second->create(strm)};
-			}
+		const auto own = std::ranges::find_if(routeSerializers, [&accept](const auto & serializer) {
+			return (!accept.group || serializer.first.group == accept.group)
+					&& (!accept.type || serializer.first.type == accept.type);
+		});
+		const auto * shared = addDefaultSerializers ? coreSerializers->find(accept) : nullptr;
+		if (own == routeSerializers.end()) {
+			return shared;
 		}
-		return {};
+		// As though both were one map, with the route's own replacing the Core's
+		if (shared && shared->first < own->first) {
+			return shared;
+		}
+		return &*own;
 	}
 
 	ContentTypeSerializer
 	IRouteHandler::defaultSerializer(std::ostream & strm) const
 	{
-		return {{.group = APPLICATION, .type = JSON},
-				Slicer::StreamSerializerFactory::createNew(APPLICATION_JSON, strm)};
+		if (defaultSerializerFactory) {
+			return {defaultContentType, defaultSerializerFactory->create(strm)};
+		}
+		// Nothing registered when the route was built; fail (or succeed) as a by name lookup would now
+		return {defaultContentType,
+				Slicer::StreamSerializerFactory::createNew(
+						MimeTypeFmt::get(defaultContentType.group, defaultContentType.type), strm)};
+	}
+
+	const MimeType &
+	IRouteHandler::getDefaultContentType() const
+	{
+		return defaultContentType;
+	}
+
+	const IRouteHandler::StreamSerializerFactoryPtr &
+	IRouteHandler::getDefaultSerializerFactory() const
+	{
+		return defaultSerializerFactory;
 	}
 
 	void
@@ -66,5 +120,24 @@ namespace IceSpider {
 	{
 		routeSerializers.erase(contentType);
 		routeSerializers.emplace(contentType, ssfp);
+		if (contentType == defaultContentType) {
+			defaultSerializerFactory = ssfp;
+		}
+	}
+
+	void
+	IRouteHandler::setDefaultContentType(const MimeType & contentType)
+	{
+		defaultContentType = contentType;
+		if (const auto own = routeSerializers.find(contentType); own != routeSerializers.end()) {
+			defaultSerializerFactory = own->second;
+		}
+		else if (const auto * registered
+				= coreSerializers->find({.group = contentType.group, .type = contentType.type})) {
+			defaultSerializerFactory = registered->second;
+		}
+		else {
+			defaultSerializerFactory.reset();
+		}
 	}
 }
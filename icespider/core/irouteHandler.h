@@ -2,9 +2,12 @@
 
 #include "http.h"
 #include "ihttpRequest.h"
+#include "serializerTable.h"
 #include "slicer/serializer.h"
 #include <c++11Helpers.h>
+#include <exception>
 #include <factory.h> // IWYU pragma: keep
+#include <functional>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -23,22 +26,40 @@ namespace IceSpider {
 	class DLL_PUBLIC IRouteHandler : public Path {
 	public:
 		const static RouteOptions DEFAULT_ROUTE_OPTIONS;
+		using StreamSerializerFactoryPtr = SerializerTable::StreamSerializerFactoryPtr;
+		using RouteSerializers = std::map<MimeType, StreamSerializerFactoryPtr>;
+		// Called exactly once when a route finishes, with the exception if it failed
+		using Completion = std::function<void(std::exception_ptr)>;
 
+		// Without a Core, the route builds its own table from the serializers registered at the time
 		IRouteHandler(HttpMethod, std::string_view path);
 		IRouteHandler(HttpMethod, std::string_view path, const RouteOptions &);
+		IRouteHandler(const Core *, HttpMethod, std::string_view path);
+		IRouteHandler(const Core *, HttpMethod, std::string_view path, const RouteOptions &);
 		SPECIAL_MEMBERS_MOVE_RO(IRouteHandler);
 		virtual ~IRouteHandler() = default;
 
 		virtual void execute(IHttpRequest * request) const = 0;
-		virtual ContentTypeSerializer getSerializer(const Accept &, std::ostream &) const;
+		// Routes which can wait on Ice without blocking override this; by default
+		// it runs execute and completes before returning.
+		virtual void executeAsync(IHttpRequest * request, Completion completion) const;
+		// The first serializer matching accept, in MimeType order, of this route's own and the Core's together; a
+		// route's own replaces the Core's for the same type. Override to choose differently; the result is cached by
+		// route and Accept header, so it must depend on nothing else and live as long as the route.
+		[[nodiscard]] virtual const SerializerTable::Entry * findSerializer(const Accept &) const;
 		virtual ContentTypeSerializer defaultSerializer(std::ostream &) const;
+		[[nodiscard]] const MimeType & getDefaultContentType() const;
+		// Null if nothing provided the default content type when it was set
+		[[nodiscard]] const StreamSerializerFactoryPtr & getDefaultSerializerFactory() const;
 
 		const HttpMethod method;
 
 	protected:
-		using StreamSerializerFactoryPtr = std::shared_ptr<Slicer::StreamSerializerFactory>;
-		using RouteSerializers = std::map<MimeType, StreamSerializerFactoryPtr>;
+		// Only those added by this route; the Core's table is merged with these on lookup
 		RouteSerializers routeSerializers;
+		// The Core's table, or one owned by this route when it was given no Core
+		const std::shared_ptr<const SerializerTable> coreSerializers;
+		const bool addDefaultSerializers;
 
 		[[noreturn]] static void requiredParameterNotFound(const char *, std::string_view key);
 
@@ -50,6 +71,12 @@ namespace IceSpider {
 		}
 
 		void addRouteSerializer(const MimeType &, const StreamSerializerFactoryPtr &);
+		// Used when the request has no Accept header or accepts anything; the factory is resolved here, not per request
+		void setDefaultContentType(const MimeType &);
+
+	private:
+		MimeType defaultContentType;
+		StreamSerializerFactoryPtr defaultSerializerFactory;
 	};
 
 	using IRouteHandlerPtr = std::shared_ptr<IRouteHandler>;
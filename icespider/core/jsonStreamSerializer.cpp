@@ -0,0 +1,448 @@
+#include "jsonStreamSerializer.h"
+#include <Ice/Config.h>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <plugins.h>
+#include <slicer/metadata.h>
+#include <string>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#	include <immintrin.h>
+#	define JSON_X86
+#endif
+
+namespace IceSpider {
+	namespace {
+		constexpr std::string_view NULL_VALUE {"null"};
+		constexpr std::string_view TRUE_VALUE {"true"};
+		constexpr std::string_view FALSE_VALUE {"false"};
+		constexpr std::string_view TYPE_ID_PROPERTY {"slicer-typeid"};
+		constexpr std::string_view MD_OBJECT {"json:object"};
+		constexpr std::string_view MD_NAME {"json:name:"};
+		constexpr std::string_view KEY {"key"};
+		constexpr std::string_view VALUE {"value"};
+		constexpr unsigned char FIRST_PRINTABLE = 0x20;
+		constexpr std::size_t NUMBER_BUFFER = 32;
+
+		void
+		put(std::streambuf & out, const std::string_view value)
+		{
+			out.sputn(value.data(), static_cast<std::streamsize>(value.length()));
+		}
+
+		// Enough for any 64 bit integer, or the shortest round trip form of any double
+		using NumberBuffer = std::array<char, NUMBER_BUFFER>;
+
+		template<typename Number>
+		std::string_view
+		formatNumber(NumberBuffer & buffer, const Number value)
+		{
+			const auto result = std::to_chars(buffer.begin(), buffer.end(), value);
+			return {buffer.data(), result.ptr};
+		}
+
+		template<typename Number>
+		void
+		putNumber(std::streambuf & out, const Number value)
+		{
+			if constexpr (std::is_floating_point_v<Number>) {
+				if (!std::isfinite(value)) {
+					put(out, NULL_VALUE);
+					return;
+				}
+			}
+			NumberBuffer buffer {};
+			put(out, formatNumber(buffer, value));
+		}
+
+		// Writes whatever simple value it's given, as JSON
+		class JsonValueTarget : public Slicer::ValueTarget {
+		public:
+			explicit JsonValueTarget(std::streambuf & out) : out(out) { }
+
+			void
+			get(const bool & value) const override
+			{
+				put(out, value ? TRUE_VALUE : FALSE_VALUE);
+			}
+
+			void
+			get(const std::string & value) const override
+			{
+				JsonStreamSerializer::writeString(out, value);
+			}
+
+#define GET(T) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void get(const T & value) const override \
+	{ \
+		putNumber(out, value); \
+	}
+
+			GET(Ice::Byte);
+			GET(Ice::Short);
+			GET(Ice::Int);
+			GET(Ice::Long);
+			GET(Ice::Float);
+			GET(Ice::Double);
+#undef GET
+
+		private:
+			std::streambuf & out;
+		};
+
+		// Collects a simple value as text, for use as an object key
+		class JsonKeyTarget : public Slicer::ValueTarget {
+		public:
+			explicit JsonKeyTarget(std::string & key) : key(key) { }
+
+			void
+			get(const bool & value) const override
+			{
+				key = value ? TRUE_VALUE : FALSE_VALUE;
+			}
+
+			void
+			get(const std::string & value) const override
+			{
+				key = value;
+			}
+
+#define GET(T) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void get(const T & value) const override \
+	{ \
+		NumberBuffer buffer {}; \
+		key = formatNumber(buffer, value); \
+	}
+
+			GET(Ice::Byte);
+			GET(Ice::Short);
+			GET(Ice::Int);
+			GET(Ice::Long);
+			GET(Ice::Float);
+			GET(Ice::Double);
+#undef GET
+
+		private:
+			std::string & key;
+		};
+
+		constexpr auto ESCAPES = []() {
+			std::array<char, FIRST_PRINTABLE + 1> escapes {};
+			escapes['\b'] = 'b';
+			escapes['\f'] = 'f';
+			escapes['\n'] = 'n';
+			escapes['\r'] = 'r';
+			escapes['\t'] = 't';
+			return escapes;
+		}();
+
+		void
+		putEscape(std::streambuf & out, const char chr)
+		{
+			const auto code = static_cast<unsigned char>(chr);
+			if (chr == '"' || chr == '\\') {
+				const std::array<char, 2> escaped {'\\', chr};
+				out.sputn(escaped.data(), escaped.size());
+			}
+			else if (const auto shortEscape = ESCAPES[code]) {
+				const std::array<char, 2> escaped {'\\', shortEscape};
+				out.sputn(escaped.data(), escaped.size());
+			}
+			else {
+				constexpr std::string_view HEX {"0123456789abcdef"};
+				const std::array<char, 6> escaped {'\\', 'u', '0', '0', HEX[code >> 4U], HEX[code & 0xfU]};
+				out.sputn(escaped.data(), escaped.size());
+			}
+		}
+
+		constexpr bool
+		needsEscape(const char chr)
+		{
+			return static_cast<unsigned char>(chr) < FIRST_PRINTABLE || chr == '"' || chr == '\\';
+		}
+
+		using PlainPrefix = std::size_t (*)(std::string_view, std::size_t offset);
+
+		std::size_t
+		scalarPlainPrefix(const std::string_view value, std::size_t offset)
+		{
+			for (; offset < value.length(); ++offset) {
+				if (needsEscape(value[offset])) {
+					return offset;
+				}
+			}
+			return offset;
+		}
+
+#ifdef JSON_X86
+		// The vector scans are built for their instruction set whatever the build targets, and only chosen when
+		// the CPU has it; each leaves any tail to the narrower one
+
+		[[gnu::target("sse2")]] std::size_t
+		sse2PlainPrefix(const std::string_view value, std::size_t offset)
+		{
+			constexpr std::size_t WIDTH = sizeof(__m128i);
+			const auto quote = _mm_set1_epi8('"');
+			const auto backslash = _mm_set1_epi8('\\');
+			const auto control = _mm_set1_epi8(FIRST_PRINTABLE - 1);
+			for (; offset + WIDTH <= value.length(); offset += WIDTH) {
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(value.data() + offset));
+				// max(c, 0x1f) == 0x1f exactly when c <= 0x1f, as an unsigned comparison
+				const auto special = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+						_mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+				if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(special))) {
+					return offset + static_cast<std::size_t>(std::countr_zero(mask));
+				}
+			}
+			return scalarPlainPrefix(value, offset);
+		}
+
+		[[gnu::target("avx2")]] std::size_t
+		avx2PlainPrefix(const std::string_view value, std::size_t offset)
+		{
+			constexpr std::size_t WIDTH = sizeof(__m256i);
+			const auto quote = _mm256_set1_epi8('"');
+			const auto backslash = _mm256_set1_epi8('\\');
+			const auto control = _mm256_set1_epi8(FIRST_PRINTABLE - 1);
+			for (; offset + WIDTH <= value.length(); offset += WIDTH) {
+				// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+				const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(value.data() + offset));
+				const auto special = _mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+						_mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control));
+				if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(special))) {
+					return offset + static_cast<std::size_t>(std::countr_zero(mask));
+				}
+			}
+			return sse2PlainPrefix(value, offset);
+		}
+#endif
+
+		PlainPrefix
+		detectPlainPrefix()
+		{
+#ifdef JSON_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) {
+				return avx2PlainPrefix;
+			}
+			if (__builtin_cpu_supports("sse2")) {
+				return sse2PlainPrefix;
+			}
+#endif
+			return scalarPlainPrefix;
+		}
+	}
+
+	Slicer::SerializerPtr
+	JsonStreamSerializer::IceSpiderFactory::create(std::ostream & strm) const
+	{
+		return std::make_shared<JsonStreamSerializer>(strm);
+	}
+
+	JsonStreamSerializer::JsonStreamSerializer(std::ostream & strm) : out(*strm.rdbuf()) { }
+
+	JsonStreamSerializer::JsonStreamSerializer(std::streambuf & out) : out(out) { }
+
+	void
+	JsonStreamSerializer::Serialize(Slicer::ModelPartForRootParam modelPart)
+	{
+		modelPart->OnEachChild([this](const auto &, auto child, auto) {
+			writeModelPart(child);
+		});
+	}
+
+	std::size_t
+	JsonStreamSerializer::plainPrefix(const std::string_view value)
+	{
+		// Chosen once, on first use
+		static const auto scan = detectPlainPrefix();
+		return scan(value, 0);
+	}
+
+	void
+	JsonStreamSerializer::writeString(std::streambuf & out, std::string_view value)
+	{
+		out.sputc('"');
+		while (!value.empty()) {
+			const auto plain = plainPrefix(value);
+			put(out, value.substr(0, plain));
+			if (plain == value.length()) {
+				break;
+			}
+			putEscape(out, value[plain]);
+			value.remove_prefix(plain + 1);
+		}
+		out.sputc('"');
+	}
+
+	void
+	JsonStreamSerializer::writeRaw(std::streambuf & out, const std::string_view json)
+	{
+		put(out, json);
+	}
+
+	void
+	JsonStreamSerializer::writeValue(std::streambuf & out, const bool value)
+	{
+		put(out, value ? TRUE_VALUE : FALSE_VALUE);
+	}
+
+	void
+	JsonStreamSerializer::writeValue(std::streambuf & out, const std::string & value)
+	{
+		writeString(out, value);
+	}
+
+	void
+	JsonStreamSerializer::writeKey(std::streambuf & out, const bool value)
+	{
+		writeString(out, value ? TRUE_VALUE : FALSE_VALUE);
+	}
+
+	void
+	JsonStreamSerializer::writeKey(std::streambuf & out, const std::string & value)
+	{
+		writeString(out, value);
+	}
+
+#define WRITE(T) \
+	void JsonStreamSerializer::writeValue(std::streambuf & out, const T value) \
+	{ \
+		putNumber(out, value); \
+	} \
+\
+	void JsonStreamSerializer::writeKey(std::streambuf & out, const T value) \
+	{ \
+		NumberBuffer buffer {}; \
+		writeString(out, formatNumber(buffer, value)); \
+	}
+
+	WRITE(Ice::Byte);
+	WRITE(Ice::Short);
+	WRITE(Ice::Int);
+	WRITE(Ice::Long);
+	WRITE(Ice::Float);
+	WRITE(Ice::Double);
+#undef WRITE
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	JsonStreamSerializer::writeModelPart(const Slicer::ModelPartParam modelPart)
+	{
+		if (!modelPart || !modelPart->HasValue()) {
+			put(out, NULL_VALUE);
+			return;
+		}
+		switch (modelPart->GetType()) {
+			case Slicer::ModelPartType::Null:
+				put(out, NULL_VALUE);
+				break;
+			case Slicer::ModelPartType::Simple:
+				modelPart->GetValue(JsonValueTarget {out});
+				break;
+			case Slicer::ModelPartType::Complex:
+				writeComplex(modelPart);
+				break;
+			case Slicer::ModelPartType::Sequence:
+				writeSequence(modelPart);
+				break;
+			case Slicer::ModelPartType::Dictionary:
+				if (modelPart->GetMetadata().flagSet(MD_OBJECT)) {
+					writeObjectDictionary(modelPart);
+				}
+				else {
+					// An array of {"key": ..., "value": ...} objects
+					writeSequence(modelPart);
+				}
+				break;
+		}
+	}
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	JsonStreamSerializer::writeComplex(const Slicer::ModelPartParam modelPart)
+	{
+		out.sputc('{');
+		bool first = true;
+		const auto separate = [this, &first]() {
+			if (!first) {
+				out.sputc(',');
+			}
+			first = false;
+		};
+		if (const auto typeId = modelPart->GetTypeId()) {
+			separate();
+			writeString(out, TYPE_ID_PROPERTY);
+			out.sputc(':');
+			writeString(out, *typeId);
+		}
+		modelPart->OnEachChild([this, &separate](const auto & name, auto child, auto hook) {
+			if (child && child->HasValue()) {
+				separate();
+				const auto jsonName = hook ? hook->GetMetadata().value(MD_NAME) : std::nullopt;
+				writeString(out, jsonName ? *jsonName : std::string_view {name});
+				out.sputc(':');
+				writeModelPart(child);
+			}
+		});
+		out.sputc('}');
+	}
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	JsonStreamSerializer::writeSequence(const Slicer::ModelPartParam modelPart)
+	{
+		out.sputc('[');
+		bool first = true;
+		modelPart->OnEachChild([this, &first](const auto &, auto child, auto) {
+			if (!first) {
+				out.sputc(',');
+			}
+			first = false;
+			writeModelPart(child);
+		});
+		out.sputc(']');
+	}
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	JsonStreamSerializer::writeObjectDictionary(const Slicer::ModelPartParam modelPart)
+	{
+		out.sputc('{');
+		bool first = true;
+		std::string key;
+		modelPart->OnEachChild([this, &first, &key](const auto &, auto element, auto) {
+			if (!first) {
+				out.sputc(',');
+			}
+			first = false;
+			element->OnChild(
+					[&key](Slicer::ModelPartParam keyPart, const Slicer::Metadata &) {
+						keyPart->GetValue(JsonKeyTarget {key});
+					},
+					KEY);
+			writeString(out, key);
+			out.sputc(':');
+			element->OnChild(
+					[this](Slicer::ModelPartParam valuePart, const Slicer::Metadata &) {
+						writeModelPart(valuePart);
+					},
+					VALUE);
+		});
+		out.sputc('}');
+	}
+}
+
+NAMEDPLUGIN(std::string {IceSpider::JsonStreamSerializer::PLUGIN_NAME},
+		IceSpider::JsonStreamSerializer::IceSpiderFactory, Slicer::StreamSerializerFactory);
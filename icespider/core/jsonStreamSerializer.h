@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Ice/Config.h>
+#include <iosfwd>
+#include <slicer/modelParts.h>
+#include <slicer/serializer.h>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <visibility.h>
+
+namespace IceSpider {
+	// Writes JSON straight into the output stream's buffer: strings are scanned for characters needing escapes a
+	// vector at a time, as wide as this CPU allows, and numbers are formatted with std::to_chars. Registered as its
+	// own plugin, PLUGIN_NAME; each Core serves application/json with it unless IceSpider.JsonSerializer names another.
+	class DLL_PUBLIC JsonStreamSerializer : public Slicer::Serializer {
+	public:
+		static constexpr std::string_view PLUGIN_NAME {"icespider/json"};
+
+		class IceSpiderFactory : public Slicer::StreamSerializerFactory {
+		public:
+			Slicer::SerializerPtr create(std::ostream &) const override;
+		};
+
+		explicit JsonStreamSerializer(std::ostream &);
+		explicit JsonStreamSerializer(std::streambuf &);
+
+		void Serialize(Slicer::ModelPartForRootParam modelPart) override;
+
+		// Writes value as a quoted, escaped JSON string
+		static void writeString(std::streambuf &, std::string_view value);
+		// The length of value's leading run which needs no escaping
+		[[nodiscard]] static std::size_t plainPrefix(std::string_view value);
+
+		// Building blocks for the typed writers the route compiler can generate
+		static void writeRaw(std::streambuf &, std::string_view json);
+		static void writeValue(std::streambuf &, bool);
+		static void writeValue(std::streambuf &, Ice::Byte);
+		static void writeValue(std::streambuf &, Ice::Short);
+		static void writeValue(std::streambuf &, Ice::Int);
+		static void writeValue(std::streambuf &, Ice::Long);
+		static void writeValue(std::streambuf &, Ice::Float);
+		static void writeValue(std::streambuf &, Ice::Double);
+		static void writeValue(std::streambuf &, const std::string &);
+		// Writes value as an object key, formatted as it would be by the slicer path
+		static void writeKey(std::streambuf &, bool);
+		static void writeKey(std::streambuf &, Ice::Byte);
+		static void writeKey(std::streambuf &, Ice::Short);
+		static void writeKey(std::streambuf &, Ice::Int);
+		static void writeKey(std::streambuf &, Ice::Long);
+		static void writeKey(std::streambuf &, Ice::Float);
+		static void writeKey(std::streambuf &, Ice::Double);
+		static void writeKey(std::streambuf &, const std::string &);
+
+		// Writes value by way of its slicer model, for anything a typed writer can't handle itself
+		template<typename T>
+		static void
+		writeModel(std::streambuf & out, const T & value)
+		{
+			Slicer::ModelPart::OnRootFor(value, [&out](Slicer::ModelPartForRootParam root) {
+				JsonStreamSerializer {out}.Serialize(root);
+			});
+		}
+
+	private:
+		void writeModelPart(Slicer::ModelPartParam);
+		void writeComplex(Slicer::ModelPartParam);
+		void writeSequence(Slicer::ModelPartParam);
+		void writeObjectDictionary(Slicer::ModelPartParam);
+
+		std::streambuf & out;
+	};
+}
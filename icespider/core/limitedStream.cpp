@@ -0,0 +1,47 @@
+#include "limitedStream.h"
+#include "exceptions.h"
+#include <algorithm>
+
+namespace IceSpider {
+	LimitedStreamBuf::LimitedStreamBuf(std::streambuf & source, const std::size_t limit, const Limit limitType) :
+		source(source), remaining(limit), limitType(limitType)
+	{
+	}
+
+	LimitedStreamBuf::int_type
+	LimitedStreamBuf::underflow()
+	{
+		if (remaining == 0) {
+			if (limitType == Limit::Ceiling && !traits_type::eq_int_type(source.sgetc(), traits_type::eof())) {
+				throw Http413PayloadTooLarge();
+			}
+			return traits_type::eof();
+		}
+		const auto got = source.sgetn(chunk.data(), static_cast<std::streamsize>(std::min(remaining, chunk.size())));
+		if (got <= 0) {
+			return traits_type::eof();
+		}
+		remaining -= static_cast<std::size_t>(got);
+		setg(chunk.data(), chunk.data(), chunk.data() + got);
+		return traits_type::to_int_type(chunk.front());
+	}
+
+	std::streamsize
+	LimitedStreamBuf::showmanyc()
+	{
+		// A declared length is the best estimate there is of what's to come
+		if (limitType == Limit::Length) {
+			return remaining ? static_cast<std::streamsize>(remaining) : -1;
+		}
+		return std::min(source.in_avail(), static_cast<std::streamsize>(remaining));
+	}
+
+	LimitedInputStream::LimitedInputStream(
+			std::streambuf & source, const std::size_t limit, const LimitedStreamBuf::Limit limitType) :
+		std::istream(nullptr), buffer(source, limit, limitType)
+	{
+		rdbuf(&buffer);
+		// Rethrows whatever the buffer throws, rather than just setting badbit
+		exceptions(badbit);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+#include <visibility.h>
+
+namespace IceSpider {
+	// Reads no more than limit chars from source, in chunks. What happens after that depends on what the limit is:
+	// a declared length simply ends the input; a ceiling on input of unknown length throws Http413PayloadTooLarge if
+	// there is any more.
+	class DLL_PUBLIC LimitedStreamBuf : public std::streambuf {
+	public:
+		enum class Limit : uint8_t { Length, Ceiling };
+
+		LimitedStreamBuf(std::streambuf & source, std::size_t limit, Limit);
+
+	protected:
+		int_type underflow() override;
+		std::streamsize showmanyc() override;
+
+	private:
+		static constexpr std::size_t CHUNK_SIZE = 4096;
+
+		std::streambuf & source;
+		std::size_t remaining;
+		const Limit limitType;
+		std::array<char, CHUNK_SIZE> chunk {};
+	};
+
+	// An istream over a LimitedStreamBuf which lets its exceptions through
+	class DLL_PUBLIC LimitedInputStream : public std::istream {
+	public:
+		LimitedInputStream(std::streambuf & source, std::size_t limit, LimitedStreamBuf::Limit);
+
+	private:
+		LimitedStreamBuf buffer;
+	};
+}
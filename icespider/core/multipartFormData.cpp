@@ -0,0 +1,286 @@
+#include "multipartFormData.h"
+#include "exceptions.h"
+#include <algorithm>
+#include <boost/algorithm/string/predicate.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <factory.h>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <plugins.h>
+#include <slicer/serializer.h>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace IceSpider {
+	namespace {
+		constexpr std::size_t CHUNK_SIZE = 64UL * 1024UL;
+		constexpr std::string_view CRLF {"\r\n"};
+		constexpr std::string_view DASHES {"--"};
+		constexpr std::string_view HEADERS_END {"\r\n\r\n"};
+		constexpr std::string_view WHITESPACE {" \t"};
+		constexpr std::string_view BOUNDARY {"boundary"};
+		constexpr std::string_view CONTENT_DISPOSITION {"content-disposition"};
+		constexpr std::string_view CONTENT_TYPE {"content-type"};
+		constexpr std::string_view TEXT {"text/"};
+		constexpr std::string_view FORM_DATA {"form-data"};
+		constexpr std::string_view NAME {"name"};
+
+		void
+		trim(std::string_view & value)
+		{
+			value.remove_prefix(std::min(value.find_first_not_of(WHITESPACE), value.length()));
+			value.remove_suffix(value.length() - std::min(value.find_last_not_of(WHITESPACE) + 1, value.length()));
+		}
+
+		void
+		write(std::FILE * file, const std::string_view data)
+		{
+			if (std::fwrite(data.data(), 1, data.length(), file) != data.length()) {
+				throw std::system_error(errno, std::generic_category(), "Spooling form data");
+			}
+		}
+	}
+
+	Slicer::DeserializerPtr
+	MultipartFormData::Factory::create(std::istream &) const
+	{
+		throw Http400BadRequest();
+	}
+
+	Slicer::DeserializerPtr
+	MultipartFormData::Factory::create(std::istream & input, const std::string_view parameters) const
+	{
+		return std::make_shared<MultipartFormData>(input, parameter(parameters, BOUNDARY) / []() -> std::string_view {
+			throw Http400BadRequest();
+		});
+	}
+
+	MultipartFormData::MultipartFormData(std::istream & input, const std::string_view boundary) :
+		input(input), delimiter(std::string {CRLF}.append(DASHES).append(boundary)),
+		searcher(delimiter.begin(), delimiter.end()),
+		// The body's opening delimiter has no CRLF of its own, but looks like all the others if given one
+		buffer(CRLF)
+	{
+		if (boundary.empty() || boundary.length() > MAX_BOUNDARY) {
+			throw Http400BadRequest();
+		}
+		// Anything before the first delimiter is preamble, to be ignored
+		skipPast(nullptr);
+		// A delimiter followed by -- is the last; anything after it is epilogue, also ignored
+		while (!(ensure(DASHES.length()) && view().starts_with(DASHES))) {
+			// Any transport padding, the rest of the delimiter's line
+			const auto lineEnd = find(CRLF, MAX_BOUNDARY);
+			if (view().find_first_not_of(WHITESPACE) < lineEnd) {
+				throw Http400BadRequest();
+			}
+			consumed += lineEnd + CRLF.length();
+			// The part's headers end with an empty line, which is all there is if there are none
+			const auto headersEnd = (ensure(CRLF.length()) && view().starts_with(CRLF))
+					? 0
+					: find(HEADERS_END, MAX_PART_HEADERS) + CRLF.length();
+			const auto field = partField(view().substr(0, headersEnd));
+			consumed += headersEnd + CRLF.length();
+			Part part;
+			skipPast(&part);
+			addField(field, std::move(part));
+		}
+	}
+
+	std::optional<std::string_view>
+	MultipartFormData::parameter(std::string_view parameters, const std::string_view name)
+	{
+		while (!parameters.empty()) {
+			const auto equals = parameters.find_first_of("=;");
+			auto key = parameters.substr(0, equals);
+			trim(key);
+			if (equals == std::string_view::npos) {
+				break;
+			}
+			const bool hasValue = parameters[equals] == '=';
+			parameters.remove_prefix(equals + 1);
+			if (!hasValue) {
+				continue;
+			}
+			trim(parameters);
+			std::string_view value;
+			if (parameters.starts_with('"')) {
+				const auto closeQuote = parameters.find('"', 1);
+				if (closeQuote == std::string_view::npos) {
+					throw Http400BadRequest();
+				}
+				value = parameters.substr(1, closeQuote - 1);
+				parameters.remove_prefix(closeQuote + 1);
+			}
+			else {
+				value = parameters.substr(0, parameters.find(';'));
+				parameters.remove_prefix(value.length());
+				trim(value);
+			}
+			parameters.remove_prefix(std::min(parameters.find(';'), parameters.length()));
+			if (!parameters.empty()) {
+				parameters.remove_prefix(1);
+			}
+			if (boost::algorithm::iequals(key, name)) {
+				return value;
+			}
+		}
+		return std::nullopt;
+	}
+
+	std::string_view
+	MultipartFormData::view() const
+	{
+		return std::string_view {buffer}.substr(consumed);
+	}
+
+	bool
+	MultipartFormData::fill()
+	{
+		buffer.erase(0, consumed);
+		consumed = 0;
+		const auto length = buffer.length();
+		buffer.resize(length + CHUNK_SIZE);
+		const auto got = input.rdbuf()->sgetn(buffer.data() + length, static_cast<std::streamsize>(CHUNK_SIZE));
+		buffer.resize(length + static_cast<std::size_t>(std::max<std::streamsize>(got, 0)));
+		return got > 0;
+	}
+
+	bool
+	MultipartFormData::ensure(const std::size_t length)
+	{
+		while (view().length() < length) {
+			if (!fill()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::size_t
+	MultipartFormData::find(const std::string_view needle, const std::size_t limit)
+	{
+		while (true) {
+			if (const auto pos = view().find(needle); pos != std::string_view::npos) {
+				return pos;
+			}
+			if (view().length() > limit || !fill()) {
+				throw Http400BadRequest();
+			}
+		}
+	}
+
+	void
+	MultipartFormData::skipPast(Part * const part)
+	{
+		while (true) {
+			const auto content = view();
+			if (const auto found = std::search(content.begin(), content.end(), searcher); found != content.end()) {
+				const auto length = static_cast<std::size_t>(found - content.begin());
+				if (part) {
+					part->append(content.substr(0, length));
+				}
+				consumed += length + delimiter.length();
+				return;
+			}
+			// All but what might be the start of a delimiter, split across reads, is content
+			const auto length = content.length() - std::min(content.length(), delimiter.length() - 1);
+			if (part) {
+				part->append(content.substr(0, length));
+			}
+			consumed += length;
+			if (!fill()) {
+				throw Http400BadRequest();
+			}
+		}
+	}
+
+	FormDeserializer::Field
+	MultipartFormData::partField(std::string_view headers)
+	{
+		std::optional<std::string_view> name;
+		bool binary = false;
+		while (!headers.empty()) {
+			const auto lineEnd = headers.find(CRLF);
+			const auto line = headers.substr(0, lineEnd);
+			headers.remove_prefix(std::min(lineEnd, headers.length()));
+			if (!headers.empty()) {
+				headers.remove_prefix(CRLF.length());
+			}
+			const auto colon = line.find(':');
+			auto header = line.substr(0, colon);
+			trim(header);
+			if (colon == std::string_view::npos) {
+				continue;
+			}
+			if (boost::algorithm::iequals(header, CONTENT_TYPE)) {
+				// Parts are text/plain unless they say otherwise; file uploads typically do
+				auto type = line.substr(colon + 1);
+				trim(type);
+				binary = !boost::algorithm::istarts_with(type, TEXT);
+				continue;
+			}
+			if (!boost::algorithm::iequals(header, CONTENT_DISPOSITION)) {
+				continue;
+			}
+			const auto disposition = line.substr(colon + 1);
+			const auto semicolon = disposition.find(';');
+			auto type = disposition.substr(0, semicolon);
+			trim(type);
+			if (!boost::algorithm::iequals(type, FORM_DATA) || semicolon == std::string_view::npos) {
+				throw Http400BadRequest();
+			}
+			name = parameter(disposition.substr(semicolon + 1), NAME) / []() -> std::string_view {
+				throw Http400BadRequest();
+			};
+		}
+		if (!name) {
+			throw Http400BadRequest();
+		}
+		// The buffer will be reused, so the name is copied
+		auto * const copy = static_cast<char *>(arena.allocate(name->length(), 1));
+		return {.name = {copy, name->copy(copy, name->length())}, .value = {}, .binary = binary};
+	}
+
+	void
+	MultipartFormData::addField(Field field, Part && part)
+	{
+		if (part.spool) {
+			field.spool = part.spool.get();
+			field.spooledLength = part.length;
+			spools.push_back(std::move(part.spool));
+		}
+		else if (!part.memory.empty()) {
+			auto * const copy = static_cast<char *>(arena.allocate(part.memory.length(), 1));
+			field.value = {copy, part.memory.copy(copy, part.memory.length())};
+		}
+		fields.push_back(field);
+	}
+
+	void
+	MultipartFormData::Part::append(const std::string_view data)
+	{
+		if (!spool && memory.length() + data.length() > MEMORY_LIMIT) {
+			spool.reset(std::tmpfile());
+			if (!spool) {
+				throw std::system_error(errno, std::generic_category(), "Spooling form data");
+			}
+			write(spool.get(), memory);
+			memory.clear();
+			memory.shrink_to_fit();
+		}
+		if (spool) {
+			write(spool.get(), data);
+		}
+		else {
+			memory.append(data);
+		}
+		length += data.length();
+	}
+}
+
+NAMEDPLUGIN("multipart/form-data", IceSpider::MultipartFormData::Factory, Slicer::StreamDeserializerFactory);
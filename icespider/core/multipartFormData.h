@@ -0,0 +1,73 @@
+#pragma once
+
+#include "formDeserializer.h"
+#include "ihttpRequest.h"
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <slicer/serializer.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IceSpider {
+	// Parses a multipart/form-data body as it's read, finding each boundary with a Boyer-Moore-Horspool search. Parts
+	// larger than MEMORY_LIMIT are spooled to anonymous temporary files, so memory use doesn't grow with the upload.
+	class MultipartFormData : public FormDeserializer {
+	public:
+		class Factory : public ParameterisedDeserializerFactory {
+		public:
+			// Without parameters, there's no boundary
+			[[nodiscard]] Slicer::DeserializerPtr create(std::istream &) const override;
+			[[nodiscard]] Slicer::DeserializerPtr create(std::istream &, std::string_view parameters) const override;
+		};
+
+		MultipartFormData(std::istream & input, std::string_view boundary);
+
+		// The named parameter's value, unquoted, from a ;-separated list such as a Content-Type's parameters
+		[[nodiscard]] static std::optional<std::string_view> parameter(
+				std::string_view parameters, std::string_view name);
+
+		static constexpr std::size_t MEMORY_LIMIT = 64UL * 1024UL;
+		static constexpr std::size_t MAX_PART_HEADERS = 8UL * 1024UL;
+		static constexpr std::size_t MAX_BOUNDARY = 70;
+
+	private:
+		using FilePtr = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+		// Accumulates a part's content, in memory until it's too big for that
+		class Part {
+		public:
+			void append(std::string_view);
+
+			std::string memory;
+			FilePtr spool {nullptr, &std::fclose};
+			std::size_t length {};
+		};
+
+		[[nodiscard]] std::string_view view() const;
+		// Reads more input onto the end of the buffer, discarding what's been consumed; false at the end of the input
+		bool fill();
+		bool ensure(std::size_t);
+		[[nodiscard]] std::size_t find(std::string_view, std::size_t limit);
+		// Consumes input up to and including the next delimiter, adding what comes before it to part, if given
+		void skipPast(Part * part);
+		// A field named by the part's Content-Disposition, binary if its Content-Type isn't text
+		[[nodiscard]] Field partField(std::string_view headers);
+		void addField(Field field, Part && part);
+
+		std::istream & input;
+		// CRLF--boundary, which precedes every part and follows the last
+		const std::string delimiter;
+		const std::boyer_moore_horspool_searcher<std::string::const_iterator> searcher;
+		std::string buffer;
+		std::size_t consumed {};
+		// Copies of field names and of values kept in memory
+		std::pmr::monotonic_buffer_resource arena;
+		std::vector<FilePtr> spools;
+	};
+}
@@ -0,0 +1,60 @@
+#include "negotiationCache.h"
+#include <mutex>
+
+namespace IceSpider {
+	NegotiationCache::NegotiationCache(const std::size_t capacity) : capacity(capacity) { }
+
+	NegotiationCache::NegotiationCache(NegotiationCache && other) noexcept :
+		capacity(other.capacity), hits(other.hits.load()), misses(other.misses.load())
+	{
+		const std::unique_lock otherLock {other.lock};
+		entries = std::move(other.entries);
+	}
+
+	std::optional<NegotiatedSerializer>
+	NegotiationCache::find(const IRouteHandler * route, const std::string_view accept) const
+	{
+		{
+			const std::shared_lock sharedLock {lock};
+			if (const auto entry = entries.find(KeyView {route, accept}); entry != entries.end()) {
+				++hits;
+				return entry->second;
+			}
+		}
+		++misses;
+		return std::nullopt;
+	}
+
+	void
+	NegotiationCache::insert(
+			const IRouteHandler * route, const std::string_view accept, const NegotiatedSerializer & negotiated)
+	{
+		if (accept.length() > MAX_ACCEPT_LENGTH) {
+			return;
+		}
+		const std::unique_lock uniqueLock {lock};
+		if (entries.size() >= capacity) {
+			entries.clear();
+		}
+		entries.try_emplace(Key {route, accept}, negotiated);
+	}
+
+	std::size_t
+	NegotiationCache::size() const
+	{
+		const std::shared_lock sharedLock {lock};
+		return entries.size();
+	}
+
+	std::size_t
+	NegotiationCache::getHits() const
+	{
+		return hits;
+	}
+
+	std::size_t
+	NegotiationCache::getMisses() const
+	{
+		return misses;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <http.h>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <slicer/serializer.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <visibility.h>
+
+namespace IceSpider {
+	class IRouteHandler;
+
+	// The result of matching an Accept header against a route's serializers
+	struct NegotiatedSerializer {
+		enum class Outcome : uint8_t {
+			RouteDefault,
+			Matched,
+			NotAcceptable,
+		};
+
+		Outcome outcome;
+		MimeType contentType {};
+		std::shared_ptr<Slicer::StreamSerializerFactory> factory {};
+	};
+
+	// Thread safe memo of negotiation results by route and raw Accept header value. Clients send few distinct
+	// values, so when the cache reaches capacity it is simply emptied and refilled by those still in use.
+	class DLL_PUBLIC NegotiationCache {
+	public:
+		static constexpr std::size_t DEFAULT_CAPACITY = 256;
+		// Longer header values are negotiated every time rather than stored
+		static constexpr std::size_t MAX_ACCEPT_LENGTH = 512;
+
+		explicit NegotiationCache(std::size_t capacity = DEFAULT_CAPACITY);
+		NegotiationCache(NegotiationCache &&) noexcept;
+		~NegotiationCache() = default;
+		NegotiationCache(const NegotiationCache &) = delete;
+		NegotiationCache & operator=(const NegotiationCache &) = delete;
+		NegotiationCache & operator=(NegotiationCache &&) = delete;
+
+		[[nodiscard]] std::optional<NegotiatedSerializer> find(const IRouteHandler *, std::string_view accept) const;
+		void insert(const IRouteHandler *, std::string_view accept, const NegotiatedSerializer &);
+
+		[[nodiscard]] std::size_t size() const;
+		[[nodiscard]] std::size_t getHits() const;
+		[[nodiscard]] std::size_t getMisses() const;
+
+	private:
+		using Key = std::pair<const IRouteHandler *, std::string>;
+		using KeyView = std::pair<const IRouteHandler *, std::string_view>;
+
+		struct KeyHash {
+			using is_transparent = void; // NOLINT(readability-identifier-naming) - STL like
+
+			std::size_t
+			operator()(const KeyView & key) const
+			{
+				return std::hash<std::string_view> {}(key.second) ^ std::hash<const IRouteHandler *> {}(key.first);
+			}
+		};
+
+		struct KeyEqual {
+			using is_transparent = void; // NOLINT(readability-identifier-naming) - STL like
+
+			bool
+			operator()(const KeyView & left, const KeyView & right) const
+			{
+				return left == right;
+			}
+		};
+
+		std::size_t capacity;
+		mutable std::shared_mutex lock;
+		std::unordered_map<Key, NegotiatedSerializer, KeyHash, KeyEqual> entries;
+		mutable std::atomic<std::size_t> hits {};
+		mutable std::atomic<std::size_t> misses {};
+	};
+}
@@ -0,0 +1,86 @@
+#include "routeTrie.h"
+#include "exceptions.h"
+#include "irouteHandler.h"
+#include <algorithm>
+#include <memory>
+
+namespace IceSpider {
+	RouteTrie::RouteTrie() : nodes(1) { }
+
+	void
+	RouteTrie::add(const IRouteHandler * route)
+	{
+		NodeIndex node = 0;
+		for (const auto & part : route->parts) {
+			if (const auto * literal = dynamic_cast<const PathLiteral *>(part.get())) {
+				if (const auto child = nodes[node].literals.find(literal->value); child != nodes[node].literals.end()) {
+					node = child->second;
+				}
+				else {
+					const auto next = nodes.size();
+					nodes.emplace_back();
+					nodes[node].literals.emplace(literal->value, next);
+					node = next;
+				}
+			}
+			else {
+				if (!nodes[node].parameter) {
+					const auto next = nodes.size();
+					nodes.emplace_back();
+					nodes[node].parameter = next;
+				}
+				node = *nodes[node].parameter;
+			}
+		}
+		nodes[node].routes.push_back(route);
+	}
+
+	const IRouteHandler *
+	RouteTrie::find(const PathElements & pathparts, const HttpMethod method) const
+	{
+		bool pathMatched = false;
+		if (const auto route = find(0, pathparts.begin(), pathparts.end(), method, pathMatched)) {
+			return route;
+		}
+		if (!pathMatched) {
+			throw Http404NotFound();
+		}
+		throw Http405MethodNotAllowed();
+	}
+
+	const IRouteHandler *
+	// NOLINTNEXTLINE(misc-no-recursion)
+	RouteTrie::find(const NodeIndex nodeIndex, const PathElements::const_iterator element,
+			const PathElements::const_iterator end, const HttpMethod method, bool & pathMatched) const
+	{
+		const auto & node = nodes[nodeIndex];
+		if (element == end) {
+			if (node.routes.empty()) {
+				return nullptr;
+			}
+			pathMatched = true;
+			if (const auto route = std::ranges::find(node.routes, method, &IRouteHandler::method);
+					route != node.routes.end()) {
+				return *route;
+			}
+			return nullptr;
+		}
+		// Prefer a literal match, but fall back to the parameter edge so that, for
+		// example, DELETE /simple can still reach DELETE /{s}
+		if (const auto literal = node.literals.find(*element); literal != node.literals.end()) {
+			if (const auto route = find(literal->second, element + 1, end, method, pathMatched)) {
+				return route;
+			}
+		}
+		if (node.parameter) {
+			return find(*node.parameter, element + 1, end, method, pathMatched);
+		}
+		return nullptr;
+	}
+
+	const RouteTrie::Nodes &
+	RouteTrie::getNodes() const
+	{
+		return nodes;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "flatMap.h"
+#include <cstddef>
+#include <http.h>
+#include <optional>
+#include <pathparts.h>
+#include <string_view>
+#include <vector>
+#include <visibility.h>
+
+namespace IceSpider {
+	class IRouteHandler;
+
+	// Routes indexed by path segment; literal segments are looked up in a sorted
+	// flat map, any parameter segment follows the node's single parameter edge.
+	class DLL_PUBLIC RouteTrie {
+	public:
+		using NodeIndex = std::size_t;
+		using Literals = FlatMap<std::string_view, NodeIndex>;
+		using NodeRoutes = std::vector<const IRouteHandler *>;
+
+		struct Node {
+			Literals literals;
+			std::optional<NodeIndex> parameter;
+			NodeRoutes routes;
+		};
+
+		using Nodes = std::vector<Node>;
+
+		RouteTrie();
+
+		void add(const IRouteHandler *);
+		[[nodiscard]] const IRouteHandler * find(const PathElements &, HttpMethod) const;
+
+		[[nodiscard]] const Nodes & getNodes() const;
+
+	private:
+		[[nodiscard]] const IRouteHandler * find(NodeIndex, PathElements::const_iterator element,
+				PathElements::const_iterator end, HttpMethod, bool & pathMatched) const;
+
+		Nodes nodes;
+	};
+}
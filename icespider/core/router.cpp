@@ -0,0 +1,4 @@
+#include "router.h"
+#include <factory.impl.h>
+
+INSTANTIATEFACTORY(IceSpider::Router, const IceSpider::Core *);
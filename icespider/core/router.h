@@ -0,0 +1,32 @@
+#pragma once
+
+#include <c++11Helpers.h>
+#include <factory.h> // IWYU pragma: keep
+#include <http.h>
+#include <memory>
+#include <pathparts.h>
+#include <visibility.h>
+
+// IWYU pragma: no_include "factory.impl.h"
+
+namespace IceSpider {
+	class Core;
+	class IRouteHandler;
+
+	// Route lookup generated by the route compiler for a single configuration.
+	// Returns nullptr when no route matches; pathMatched is set when a route
+	// matched the path but not the method.
+	class DLL_PUBLIC Router {
+	public:
+		Router() = default;
+		virtual ~Router() = default;
+		SPECIAL_MEMBERS_DEFAULT(Router);
+
+		[[nodiscard]] virtual const IRouteHandler * findRoute(
+				const PathElements &, HttpMethod, bool & pathMatched) const = 0;
+	};
+
+	using RouterPtr = std::shared_ptr<Router>;
+	using RouterCPtr = std::shared_ptr<const Router>;
+	using RouterFactory = AdHoc::Factory<Router, const Core *>;
+}
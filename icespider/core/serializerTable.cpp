@@ -0,0 +1,72 @@
+#include "serializerTable.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <plugins.h>
+
+namespace IceSpider {
+	SerializerTable::SerializerTable(const std::string & jsonPlugin)
+	{
+		std::map<MimeType, StreamSerializerFactoryPtr> sorted;
+		for (const auto & serializer : AdHoc::PluginManager::getDefault()->getAll<Slicer::StreamSerializerFactory>()) {
+			if (serializer->name == JsonStreamSerializer::PLUGIN_NAME) {
+				continue;
+			}
+			const auto slash = serializer->name.find('/');
+			sorted.insert({{.group = serializer->name.substr(0, slash), .type = serializer->name.substr(slash + 1)},
+					serializer->implementation()});
+		}
+		// Whatever is registered as application/json only serves it when configured to
+		sorted.insert_or_assign({.group = "application", .type = "json"},
+				AdHoc::PluginManager::getDefault()->get<Slicer::StreamSerializerFactory>(jsonPlugin)->implementation());
+		keys.reserve(sorted.size());
+		entries.reserve(sorted.size());
+		for (auto & [contentType, factory] : sorted) {
+			keys.push_back({.group = intern(contentType.group), .type = intern(contentType.type)});
+			entries.emplace_back(contentType, std::move(factory));
+		}
+	}
+
+	const SerializerTable::Entry *
+	SerializerTable::find(const Accept & accept) const
+	{
+		const auto group = accept.group ? lookup(*accept.group) : std::nullopt;
+		const auto type = accept.type ? lookup(*accept.type) : std::nullopt;
+		if ((accept.group && !group) || (accept.type && !type)) {
+			return nullptr;
+		}
+		const auto key = std::ranges::find_if(keys, [group, type](const Key & candidate) {
+			return (!group || candidate.group == *group) && (!type || candidate.type == *type);
+		});
+		if (key == keys.end()) {
+			return nullptr;
+		}
+		return &entries[static_cast<std::size_t>(key - keys.begin())];
+	}
+
+	const SerializerTable::Entries &
+	SerializerTable::getEntries() const
+	{
+		return entries;
+	}
+
+	SerializerTable::Id
+	SerializerTable::intern(const std::string & name)
+	{
+		if (const auto existing = ids.find(name); existing != ids.end()) {
+			return existing->second;
+		}
+		const auto id = static_cast<Id>(ids.size());
+		ids.emplace(name, id);
+		return id;
+	}
+
+	std::optional<SerializerTable::Id>
+	SerializerTable::lookup(const std::string_view name) const
+	{
+		if (const auto existing = ids.find(name); existing != ids.end()) {
+			return existing->second;
+		}
+		return std::nullopt;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "flatMap.h"
+#include "ihttpRequest.h"
+#include "jsonStreamSerializer.h"
+#include <cstdint>
+#include <http.h>
+#include <memory>
+#include <optional>
+#include <slicer/serializer.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <visibility.h>
+
+namespace IceSpider {
+	// The registered stream serializers, as they are when the table is built; each Core builds one as it starts and
+	// shares it with its routes. MIME groups and types are interned as small integers when the table is built, so
+	// matching an Accept entry compares numbers.
+	class DLL_PUBLIC SerializerTable {
+	public:
+		using StreamSerializerFactoryPtr = std::shared_ptr<Slicer::StreamSerializerFactory>;
+		using Entry = std::pair<const MimeType, StreamSerializerFactoryPtr>;
+		using Entries = std::vector<Entry>;
+		using Id = uint16_t;
+
+		// application/json is served by the plugin named jsonPlugin, by default IceSpider's own writer
+		explicit SerializerTable(const std::string & jsonPlugin = std::string {JsonStreamSerializer::PLUGIN_NAME});
+
+		// The first entry, in MimeType order, matching accept
+		[[nodiscard]] const Entry * find(const Accept & accept) const;
+		[[nodiscard]] const Entries & getEntries() const;
+
+	private:
+		struct Key {
+			Id group;
+			Id type;
+		};
+
+		Id intern(const std::string & name);
+		[[nodiscard]] std::optional<Id> lookup(std::string_view name) const;
+
+		FlatMap<std::string, Id> ids;
+		std::vector<Key> keys;
+		Entries entries;
+	};
+}
@@ -0,0 +1,204 @@
+#include "urlScan.h"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#if defined(__x86_64__) || defined(__i386__)
+#	include <immintrin.h>
+#	define URLSCAN_X86
+#endif
+
+namespace IceSpider::UrlScan {
+	namespace {
+		constexpr bool
+		isDecodePlain(const char chr)
+		{
+			return chr != '%' && chr != '+';
+		}
+
+		constexpr bool
+		isEncodePlain(const char chr)
+		{
+			switch (chr) {
+				case 'a' ... 'z':
+				case 'A' ... 'Z':
+				case '0' ... '9':
+				case '-':
+				case '.':
+				case '_':
+				case '~':
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		template<bool (*isPlain)(char)>
+		std::size_t
+		scalarTail(const std::string_view value, std::size_t offset)
+		{
+			for (; offset < value.length(); ++offset) {
+				if (!isPlain(value[offset])) {
+					return offset;
+				}
+			}
+			return offset;
+		}
+
+		template<bool (*isPlain)(char)>
+		std::size_t
+		scalarPrefix(const std::string_view value)
+		{
+			return scalarTail<isPlain>(value, 0);
+		}
+
+#ifdef URLSCAN_X86
+		// Each of the vector kernels scans whole blocks of value and leaves any tail to the scalar one
+
+		[[gnu::target("sse2")]] __m128i
+		inRange(const __m128i chunk, const char low, const char high)
+		{
+			// chunk - low <= high - low exactly when low <= chunk <= high, as an unsigned comparison
+			const auto offset = _mm_sub_epi8(chunk, _mm_set1_epi8(low));
+			return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(static_cast<char>(high - low))), offset);
+		}
+
+		[[gnu::target("avx2")]] __m256i
+		inRange(const __m256i chunk, const char low, const char high)
+		{
+			const auto offset = _mm256_sub_epi8(chunk, _mm256_set1_epi8(low));
+			return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(static_cast<char>(high - low))), offset);
+		}
+
+		[[gnu::target("sse2")]] uint32_t
+		decodeSpecial(const __m128i chunk)
+		{
+			const auto percent = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('%'));
+			const auto plus = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('+'));
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(percent, plus)));
+		}
+
+		[[gnu::target("avx2")]] uint32_t
+		decodeSpecial(const __m256i chunk)
+		{
+			return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+					_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('%')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('+')))));
+		}
+
+		[[gnu::target("sse2")]] uint32_t
+		encodeSpecial(const __m128i chunk)
+		{
+			// Setting bit 5 folds upper case letters onto lower case, and nothing else onto either
+			const auto letters = inRange(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 'z');
+			const auto digits = inRange(chunk, '0', '9');
+			const auto punctuation = _mm_or_si128(_mm_or_si128(inRange(chunk, '-', '.'),
+														  _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'))),
+					_mm_cmpeq_epi8(chunk, _mm_set1_epi8('~')));
+			const auto plain = static_cast<uint32_t>(
+					_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), punctuation)));
+			return ~plain & 0xFFFFU;
+		}
+
+		[[gnu::target("avx2")]] uint32_t
+		encodeSpecial(const __m256i chunk)
+		{
+			const auto letters = inRange(_mm256_or_si256(chunk, _mm256_set1_epi8(0x20)), 'a', 'z');
+			const auto digits = inRange(chunk, '0', '9');
+			const auto punctuation = _mm256_or_si256(_mm256_or_si256(inRange(chunk, '-', '.'),
+															 _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_'))),
+					_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('~')));
+			return ~static_cast<uint32_t>(
+					_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(letters, digits), punctuation)));
+		}
+
+		template<uint32_t (*special)(__m128i), bool (*isPlain)(char)>
+		[[gnu::target("sse2")]] std::size_t
+		sse2Prefix(const std::string_view value)
+		{
+			constexpr std::size_t WIDTH = sizeof(__m128i);
+			std::size_t offset = 0;
+			for (; offset + WIDTH <= value.length(); offset += WIDTH) {
+				if (const auto mask = special(
+							// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+							_mm_loadu_si128(reinterpret_cast<const __m128i *>(value.data() + offset)))) {
+					return offset + static_cast<std::size_t>(std::countr_zero(mask));
+				}
+			}
+			return scalarTail<isPlain>(value, offset);
+		}
+
+		template<uint32_t (*special)(__m256i), uint32_t (*tailSpecial)(__m128i), bool (*isPlain)(char)>
+		[[gnu::target("avx2")]] std::size_t
+		avx2Prefix(const std::string_view value)
+		{
+			constexpr std::size_t WIDTH = sizeof(__m256i);
+			std::size_t offset = 0;
+			for (; offset + WIDTH <= value.length(); offset += WIDTH) {
+				if (const auto mask = special(
+							// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+							_mm256_loadu_si256(reinterpret_cast<const __m256i *>(value.data() + offset)))) {
+					return offset + static_cast<std::size_t>(std::countr_zero(mask));
+				}
+			}
+			// A short tail still gets the 16 byte treatment
+			return offset + sse2Prefix<tailSpecial, isPlain>(value.substr(offset));
+		}
+#endif
+
+		constexpr Kernels SCALAR {"scalar", scalarPrefix<isDecodePlain>, scalarPrefix<isEncodePlain>};
+#ifdef URLSCAN_X86
+		constexpr Kernels SSE2 {"sse2", sse2Prefix<decodeSpecial, isDecodePlain>,
+				sse2Prefix<encodeSpecial, isEncodePlain>};
+		constexpr Kernels AVX2 {"avx2", avx2Prefix<decodeSpecial, decodeSpecial, isDecodePlain>,
+				avx2Prefix<encodeSpecial, encodeSpecial, isEncodePlain>};
+#endif
+
+		std::span<const Kernels>
+		detectKernels()
+		{
+#ifdef URLSCAN_X86
+			static constexpr std::array ALL {AVX2, SSE2, SCALAR};
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) {
+				return ALL;
+			}
+			if (__builtin_cpu_supports("sse2")) {
+				return std::span {ALL}.subspan(1);
+			}
+			return std::span {ALL}.subspan(2);
+#else
+			static constexpr std::array ALL {SCALAR};
+			return ALL;
+#endif
+		}
+
+		// Chosen once, on first use
+		const Kernels &
+		selected()
+		{
+			static const Kernels & kernels = supportedKernels().front();
+			return kernels;
+		}
+	}
+
+	std::span<const Kernels>
+	supportedKernels()
+	{
+		static const auto kernels = detectKernels();
+		return kernels;
+	}
+
+	std::size_t
+	decodePlainPrefix(const std::string_view value)
+	{
+		return selected().decodePlainPrefix(value);
+	}
+
+	std::size_t
+	encodePlainPrefix(const std::string_view value)
+	{
+		return selected().encodePlainPrefix(value);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <visibility.h>
+
+namespace IceSpider::UrlScan {
+	using PrefixScan = std::size_t (*)(std::string_view);
+
+	struct Kernels {
+		std::string_view name;
+		// The length of the leading run containing neither '%' nor '+', which url decoding leaves as is
+		PrefixScan decodePlainPrefix;
+		// The length of the leading run of unreserved characters, which url encoding leaves as is
+		PrefixScan encodePlainPrefix;
+	};
+
+	// Every set of kernels this CPU can run, fastest first; the first is the one used
+	[[nodiscard]] DLL_PUBLIC std::span<const Kernels> supportedKernels();
+
+	[[nodiscard]] DLL_PUBLIC std::size_t decodePlainPrefix(std::string_view);
+	[[nodiscard]] DLL_PUBLIC std::size_t encodePlainPrefix(std::string_view);
+}
@@ -1,11 +1,8 @@
 #include "xwwwFormUrlEncoded.h"
 #include "exceptions.h"
-#include "util.h"
-#include <Ice/Config.h>
+#include "urlScan.h"
 #include <algorithm>
 #include <array>
-#include <boost/algorithm/string/compare.hpp>
-#include <boost/algorithm/string/finder.hpp>
 #include <cstddef>
 #include <cstdint>
 #include <factory.h>
@@ -13,12 +10,14 @@
 #include <iterator>
 #include <limits>
 #include <maybeString.h>
+#include <memory_resource>
 #include <optional>
-#include <slicer/modelParts.h>
 #include <slicer/serializer.h>
+#include <streambuf>
+#include <string>
+#include <string_view>
 #include <utility>
 
-namespace ba = boost::algorithm;
 using namespace std::literals;
 
 namespace {
@@ -26,13 +25,14 @@ namespace {
 
 	// NOLINTBEGIN(readability-magic-numbers)
 	using HexPair = std::pair<char, char>;
-	using HexOut = std::array<HexPair, CHARMAX>;
+	// Indexed by any char, including CHARMAX itself
+	using HexOut = std::array<HexPair, CHARMAX + 1>;
 	constexpr auto HEXOUT = []() {
 		auto hexchar = [](auto chr) {
 			return static_cast<char>(chr < 10 ? '0' + chr : 'a' - 10 + chr);
 		};
 		HexOut out {};
-		for (unsigned int chr = 0; chr < CHARMAX; chr++) {
+		for (unsigned int chr = 0; chr <= CHARMAX; chr++) {
 			switch (chr) {
 				case ' ':
 					out[chr].first = '+';
@@ -95,7 +95,7 @@ namespace {
 	static_assert(!HEXTABLE['G'].has_value());
 	// NOLINTEND(readability-magic-numbers)
 
-	using HexIn = std::array<std::array<char, CHARMAX>, CHARMAX>;
+	using HexIn = std::array<std::array<char, CHARMAX + 1>, CHARMAX + 1>;
 	constexpr HexIn HEXIN = []() {
 		HexIn hexin {};
 		size_t firstHex = std::min({'0', 'a', 'A'});
@@ -119,105 +119,68 @@ namespace {
 	static_assert(HEXIN['3']['f'] == '?');
 	static_assert(HEXIN['3']['F'] == '?');
 
-	constexpr auto
-	urlEncodeRange(auto && outIter, auto input, auto end)
+	// Passes input to write as the runs needing no encoding, found a vector at a time, and the encodings of the
+	// characters between them
+	void
+	urlEncodeRange(auto && write, std::string_view input)
 	{
-		while (input != end) {
-			const auto & out = HEXOUT[static_cast<uint8_t>(*input)];
-			if (out.second) {
-				outIter = '%';
-				outIter = out.first;
-				outIter = out.second;
+		while (!input.empty()) {
+			const auto plain = IceSpider::UrlScan::encodePlainPrefix(input);
+			if (plain) {
+				write(input.substr(0, plain));
 			}
-			else if (out.first) {
-				outIter = (out.first);
+			if (plain == input.length()) {
+				break;
+			}
+			const auto & out = HEXOUT[static_cast<uint8_t>(input[plain])];
+			if (out.second) {
+				const std::array<char, 3> escape {'%', out.first, out.second};
+				write(std::string_view {escape.data(), escape.size()});
 			}
 			else {
-				outIter = (*input);
+				write(std::string_view {&out.first, 1});
 			}
-			++input;
+			input.remove_prefix(plain + 1);
 		}
 	}
 }
 
 namespace IceSpider {
 	static constexpr const std::string_view AMP = "&";
-	static constexpr const std::string_view TRUE = "true";
-	static constexpr const std::string_view FALSE = "false";
-	static constexpr const std::string_view KEY = "key";
-	static constexpr const std::string_view VALUE = "value";
-	static constexpr const std::string_view URL_ESCAPES = "%+";
 
-	XWwwFormUrlEncoded::XWwwFormUrlEncoded(std::istream & input) :
-		input(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>())
-	{
-	}
+	static constexpr std::size_t CHUNK_SIZE = 4096;
 
-	void
-	XWwwFormUrlEncoded::Deserialize(Slicer::ModelPartForRootParam modelPart)
+	XWwwFormUrlEncoded::XWwwFormUrlEncoded(std::istream & input) :
+		// Whatever is known of the body's length, typically all of it, so the arena needn't grow
+		arena(static_cast<std::size_t>(std::max<std::streamsize>(input.rdbuf()->in_avail(), 0)) + 1)
 	{
-		modelPart->Create();
-		modelPart->OnEachChild([this](const auto &, auto child, auto) {
-			switch (child->GetType()) {
-				case Slicer::ModelPartType::Simple:
-					this->deserializeSimple(child);
-					break;
-				case Slicer::ModelPartType::Complex:
-					this->deserializeComplex(child);
-					break;
-				case Slicer::ModelPartType::Dictionary:
-					this->deserializeDictionary(child);
-					break;
-				default:
-					throw IceSpider::Http400BadRequest();
-					break;
-			}
-		});
-		modelPart->Complete();
-	}
-
-	class SetFromString : public Slicer::ValueSource {
-	public:
-		explicit SetFromString(const MaybeString & value) : s(value) { }
-
-		void
-		set(bool & target) const override
-		{
-			if (s == TRUE) {
-				target = true;
-			}
-			else if (s == FALSE) {
-				target = false;
-			}
-			else {
-				throw Http400BadRequest();
+		// Pairs are decoded as each chunk arrives; only one split across chunks is ever held back
+		std::array<char, CHUNK_SIZE> chunk {};
+		std::string pending;
+		bool any = false;
+		for (std::streamsize got {};
+				(got = input.rdbuf()->sgetn(chunk.data(), static_cast<std::streamsize>(chunk.size()))) > 0;) {
+			any = true;
+			std::string_view data {chunk.data(), static_cast<std::size_t>(got)};
+			for (auto amp = data.find(AMP); amp != std::string_view::npos; amp = data.find(AMP)) {
+				if (pending.empty()) {
+					addVar(data.substr(0, amp));
+				}
+				else {
+					pending.append(data.substr(0, amp));
+					addVar(pending);
+					pending.clear();
+				}
+				data.remove_prefix(amp + AMP.length());
 			}
+			pending.append(data);
 		}
-
-		void
-		set(std::string & target) const override
-		{
-			target = s;
+		// As a split would, an empty input has no pairs but a trailing & leaves an empty one
+		if (any) {
+			addVar(pending);
 		}
-
-#define SET(T) \
-	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
-	void set(T & target) const override \
-	{ \
-		convert(s, target); \
 	}
 
-		SET(Ice::Byte);
-		SET(Ice::Short);
-		SET(Ice::Int);
-		SET(Ice::Long);
-		SET(Ice::Float);
-		SET(Ice::Double);
-
-	private:
-		const MaybeString & s;
-	};
-
 	std::string
 	XWwwFormUrlEncoded::urlencode(const std::string_view str)
 	{
@@ -229,7 +192,11 @@ namespace IceSpider {
 	{
 		std::string out;
 		out.reserve(static_cast<std::string::size_type>(std::distance(input, end)));
-		urlEncodeRange(std::back_inserter(out), input, end);
+		urlEncodeRange(
+				[&out](const std::string_view run) {
+					out.append(run);
+				},
+				{input, end});
 		return out;
 	}
 
@@ -237,36 +204,38 @@ namespace IceSpider {
 	XWwwFormUrlEncoded::urlencodeto(
 			std::ostream & outStrm, std::string_view::const_iterator input, std::string_view::const_iterator end)
 	{
-		urlEncodeRange(std::ostream_iterator<decltype(*input)>(outStrm), input, end);
+		urlEncodeRange(
+				[out = outStrm.rdbuf()](const std::string_view run) {
+					out->sputn(run.data(), static_cast<std::streamsize>(run.length()));
+				},
+				{input, end});
 	}
 
-	MaybeString
-	XWwwFormUrlEncoded::urlDecode(std::string_view::const_iterator input, std::string_view::const_iterator end)
-	{
-		const auto getNext = [end, &input] {
-			return std::find_first_of(input, end, URL_ESCAPES.begin(), URL_ESCAPES.end());
-		};
-		auto next = getNext();
-		if (next == end) {
-			return std::string_view {input, end};
-		}
-		std::string target;
-		target.reserve(static_cast<std::string::size_type>(std::distance(input, end)));
-		for (; input != end; next = getNext()) {
-			if (next != input) {
-				target.append(input, next);
-				input = next;
-			}
-			else {
+	namespace {
+		// Decodes [input, end) to out, which must have room for end - input chars
+		char *
+		urlDecodeTo(std::string_view::const_iterator input, const std::string_view::const_iterator end, char * out)
+		{
+			while (input != end) {
+				// Runs without escapes are found a vector at a time and copied in bulk
+				const auto plain = static_cast<std::ptrdiff_t>(UrlScan::decodePlainPrefix({input, end}));
+				out = std::copy_n(input, plain, out);
+				input += plain;
+				if (input == end) {
+					break;
+				}
 				switch (*input) {
 					case '+':
-						target += ' ';
+						*out++ = ' ';
 						++input;
 						break;
 					case '%':
+						if (std::distance(input, end) < 3) {
+							throw Http400BadRequest();
+						}
 						if (const auto chr
 								= HEXIN[static_cast<uint8_t>(*(input + 1))][static_cast<uint8_t>(*(input + 2))]) {
-							target += chr;
+							*out++ = chr;
 						}
 						else {
 							throw Http400BadRequest();
@@ -277,78 +246,53 @@ namespace IceSpider {
 						std::unreachable();
 				}
 			}
+			return out;
 		}
-		return target;
 	}
 
-	void
-	XWwwFormUrlEncoded::iterateVars(const KVh & handler, ba::split_iterator<std::string_view::const_iterator> pi)
+	MaybeString
+	XWwwFormUrlEncoded::urlDecode(std::string_view::const_iterator input, std::string_view::const_iterator end)
 	{
-		for (; pi != decltype(pi)(); ++pi) {
-			auto equalPos = std::find(pi->begin(), pi->end(), '=');
-			if (equalPos == pi->end()) {
-				handler(urlDecode(pi->begin(), pi->end()), {});
-			}
-			else {
-				handler(urlDecode(pi->begin(), equalPos), urlDecode(equalPos + 1, pi->end()));
-			}
+		if (UrlScan::decodePlainPrefix({input, end}) == static_cast<std::size_t>(std::distance(input, end))) {
+			return std::string_view {input, end};
 		}
+		std::string target;
+		target.resize_and_overwrite(static_cast<std::string::size_type>(std::distance(input, end)),
+				[input, end](char * out, std::string::size_type) {
+					return static_cast<std::string::size_type>(urlDecodeTo(input, end, out) - out);
+				});
+		return target;
 	}
 
-	void
-	XWwwFormUrlEncoded::iterateVars(const std::string_view input, const KVh & handler, const std::string_view split)
+	std::string_view
+	XWwwFormUrlEncoded::urlDecode(std::string_view::const_iterator input, std::string_view::const_iterator end,
+			std::pmr::memory_resource * arena)
 	{
-		if (!input.empty()) {
-			iterateVars(handler, ba::make_split_iterator(input, ba::first_finder(split, ba::is_equal())));
+		if (UrlScan::decodePlainPrefix({input, end}) == static_cast<std::size_t>(std::distance(input, end))) {
+			return std::string_view {input, end};
 		}
+		const auto length = static_cast<std::size_t>(std::distance(input, end));
+		auto * const target = static_cast<char *>(arena->allocate(length, 1));
+		return {target, urlDecodeTo(input, end, target)};
 	}
 
 	void
-	XWwwFormUrlEncoded::iterateVars(const KVh & handler)
-	{
-		iterateVars(input, handler, AMP);
-	}
-
-	void
-	XWwwFormUrlEncoded::deserializeSimple(const Slicer::ModelPartParam modelPart)
-	{
-		iterateVars([modelPart](auto &&, const auto && value) {
-			modelPart->SetValue(SetFromString(std::forward<decltype(value)>(value)));
-		});
-	}
-
-	void
-	XWwwFormUrlEncoded::deserializeComplex(const Slicer::ModelPartParam modelPart)
+	XWwwFormUrlEncoded::addVar(const std::string_view pair)
 	{
-		modelPart->Create();
-		iterateVars([modelPart](auto && key, const auto && value) {
-			modelPart->OnChild(
-					[&value](Slicer::ModelPartParam child, const Slicer::Metadata &) {
-						child->SetValue(SetFromString(std::forward<decltype(value)>(value)));
-					},
-					key);
-		});
-		modelPart->Complete();
-	}
-
-	void
-	XWwwFormUrlEncoded::deserializeDictionary(const Slicer::ModelPartParam modelPart)
-	{
-		iterateVars([modelPart](auto && key, const auto && value) {
-			modelPart->OnAnonChild([&key, &value](Slicer::ModelPartParam child, const Slicer::Metadata &) {
-				child->OnChild(
-						[&key](Slicer::ModelPartParam keyPart, const Slicer::Metadata &) {
-							keyPart->SetValue(SetFromString(std::forward<decltype(key)>(key)));
-						},
-						KEY);
-				child->OnChild(
-						[&value](Slicer::ModelPartParam valuePart, const Slicer::Metadata &) {
-							valuePart->SetValue(SetFromString(std::forward<decltype(value)>(value)));
-						},
-						VALUE);
-				child->Complete();
-			});
-		});
+		// Always a copy, as pair is in a chunk which will be reused
+		const auto decode = [this](const std::string_view encoded) -> std::string_view {
+			if (encoded.empty()) {
+				return {};
+			}
+			auto * const target = static_cast<char *>(arena.allocate(encoded.length(), 1));
+			return {target, urlDecodeTo(encoded.begin(), encoded.end(), target)};
+		};
+		if (const auto equalPos = pair.find('='); equalPos == std::string_view::npos) {
+			fields.push_back({.name = decode(pair), .value = {}});
+		}
+		else {
+			fields.push_back({.name = decode(pair.substr(0, equalPos)), .value = decode(pair.substr(equalPos + 1))});
+		}
 	}
 }
 
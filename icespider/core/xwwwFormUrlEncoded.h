@@ -1,44 +1,66 @@
 #pragma once
 
-#include <boost/algorithm/string/find_iterator.hpp>
-#include <functional>
+#include "formDeserializer.h"
+#include <cstddef>
 #include <iosfwd>
 #include <maybeString.h>
-#include <slicer/modelParts.h>
-#include <slicer/serializer.h>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <visibility.h>
 
-// IWYU pragma: no_forward_declare boost::algorithm::split_iterator
-
 namespace IceSpider {
-	class XWwwFormUrlEncoded : public Slicer::Deserializer {
+	class XWwwFormUrlEncoded : public FormDeserializer {
 	public:
-		using KVh = std::function<void(MaybeString &&, MaybeString &&)>;
-
 		explicit XWwwFormUrlEncoded(std::istream & input);
 
-		void Deserialize(Slicer::ModelPartForRootParam modelPart) override;
-		DLL_PUBLIC static void iterateVars(std::string_view input, const KVh & h, std::string_view split);
+		// Calls handler(MaybeString && key, MaybeString && value) for each pair in input, in order. Any decoded
+		// copies are allocated from arena, when given, and must not outlive it
+		template<typename Handler>
+		static void
+		iterateVars(std::string_view input, Handler && handler, const std::string_view split,
+				std::pmr::memory_resource * arena = nullptr)
+		{
+			if (input.empty()) {
+				return;
+			}
+			const auto decode = [arena](auto begin, auto end) -> MaybeString {
+				if (arena) {
+					return urlDecode(begin, end, arena);
+				}
+				return urlDecode(begin, end);
+			};
+			while (true) {
+				const auto splitPos = input.find(split);
+				const auto pair = input.substr(0, splitPos);
+				if (const auto equalPos = pair.find('='); equalPos == std::string_view::npos) {
+					handler(decode(pair.begin(), pair.end()), MaybeString {});
+				}
+				else {
+					handler(decode(pair.begin(), pair.begin() + static_cast<std::ptrdiff_t>(equalPos)),
+							decode(pair.begin() + static_cast<std::ptrdiff_t>(equalPos) + 1, pair.end()));
+				}
+				if (splitPos == std::string_view::npos) {
+					break;
+				}
+				input.remove_prefix(splitPos + split.length());
+			}
+		}
 
 		DLL_PUBLIC static MaybeString urlDecode(std::string_view::const_iterator, std::string_view::const_iterator);
+		DLL_PUBLIC static std::string_view urlDecode(
+				std::string_view::const_iterator, std::string_view::const_iterator, std::pmr::memory_resource * arena);
 		DLL_PUBLIC static std::string urlencode(std::string_view::const_iterator, std::string_view::const_iterator);
 		DLL_PUBLIC static void urlencodeto(
 				std::ostream &, std::string_view::const_iterator, std::string_view::const_iterator);
 		DLL_PUBLIC static std::string urlencode(std::string_view);
 
 	private:
-		static inline void iterateVars(
-				const KVh & h, boost::algorithm::split_iterator<std::string_view::const_iterator> pi);
-
-		void iterateVars(const KVh & h);
-
-		void deserializeSimple(Slicer::ModelPartParam modelPart);
-		void deserializeComplex(Slicer::ModelPartParam modelPart);
-		void deserializeDictionary(Slicer::ModelPartParam modelPart);
+		// Decodes a complete key[=value] pair, copying both into arena
+		void addVar(std::string_view pair);
 
-		const std::string input;
+		// Decoded keys and values; never more than the input's size in total
+		std::pmr::monotonic_buffer_resource arena;
 	};
 
 };
@@ -1,18 +1,18 @@
 #include "cgiRequestBase.h"
 #include "xwwwFormUrlEncoded.h"
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/constants.hpp>
-#include <boost/algorithm/string/find_iterator.hpp>
+#include <array>
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/split.hpp>
+#include <climits>
 #include <compileTimeFormatter.h>
+#include <cstdint>
 #include <exceptions.h>
 #include <flatMap.h>
 #include <formatters.h>
+#include <http.h>
 #include <ihttpRequest.h>
 #include <maybeString.h>
-#include <slicer/common.h>
-#include <slicer/modelPartsTypes.h>
+#include <memory_resource>
+#include <optional>
 #include <utility>
 
 namespace ba = boost::algorithm;
@@ -22,43 +22,128 @@ using namespace std::literals;
 
 namespace IceSpider {
 	namespace {
-		const auto SLASH_PRED = boost::algorithm::is_any_of("/");
 		constexpr std::string_view AMP("&");
 		constexpr std::string_view SEMI("; ");
 		constexpr std::string_view HEADER_PREFIX("HTTP_");
+		CGI_CONST(CONTENT_LENGTH);
+		CGI_CONST(CONTENT_TYPE);
 		CGI_CONST(HTTPS);
-		CGI_CONST(REDIRECT_URL);
-		CGI_CONST(SCRIPT_NAME);
-		CGI_CONST(QUERY_STRING);
 		CGI_CONST(HTTP_COOKIE);
+		CGI_CONST(QUERY_STRING);
+		CGI_CONST(REDIRECT_URL);
 		CGI_CONST(REQUEST_METHOD);
+		CGI_CONST(SCRIPT_NAME);
 
-		template<typename In, typename Out>
-		inline void
-		mapVars(const std::string_view key, const In & envmap, Out & map, const std::string_view separators)
+		using CgiVariable = CgiRequestBase::CgiVariable;
+
+		// Indexed by CgiVariable
+		constexpr std::array CGI_VARIABLE_NAMES {
+				CONTENT_LENGTH,
+				CONTENT_TYPE,
+				HTTPS,
+				HTTP_COOKIE,
+				QUERY_STRING,
+				REDIRECT_URL,
+				REQUEST_METHOD,
+				SCRIPT_NAME,
+		};
+
+		constexpr uint16_t
+		cgiVariableKey(const std::string_view name)
 		{
-			auto qs = envmap.find(key);
-			if (qs != envmap.end()) {
-				XWwwFormUrlEncoded::iterateVars(
-						qs->second,
-						[&map](auto && key, auto && value) {
-							map.insert({std::forward<decltype(key)>(key), std::forward<decltype(value)>(value)});
-						},
-						separators);
+			return static_cast<uint16_t>((name.length() << CHAR_BIT) | static_cast<unsigned char>(name.front()));
+		}
+
+		// Length and first character are unique across the names (the switch would not compile otherwise), so
+		// they select the only candidate and a single comparison confirms it
+		constexpr std::optional<CgiVariable>
+		lookupCgiVariable(const std::string_view name)
+		{
+			if (name.empty() || name.length() > UINT8_MAX) {
+				return std::nullopt;
 			}
+			const auto candidate = [name]() -> std::optional<CgiVariable> {
+				switch (cgiVariableKey(name)) {
+					case cgiVariableKey(CONTENT_LENGTH):
+						return CgiVariable::ContentLength;
+					case cgiVariableKey(CONTENT_TYPE):
+						return CgiVariable::ContentType;
+					case cgiVariableKey(HTTPS):
+						return CgiVariable::Https;
+					case cgiVariableKey(HTTP_COOKIE):
+						return CgiVariable::HttpCookie;
+					case cgiVariableKey(QUERY_STRING):
+						return CgiVariable::QueryString;
+					case cgiVariableKey(REDIRECT_URL):
+						return CgiVariable::RedirectUrl;
+					case cgiVariableKey(REQUEST_METHOD):
+						return CgiVariable::RequestMethod;
+					case cgiVariableKey(SCRIPT_NAME):
+						return CgiVariable::ScriptName;
+					default:
+						return std::nullopt;
+				}
+			}();
+			if (candidate && CGI_VARIABLE_NAMES[static_cast<std::size_t>(*candidate)] == name) {
+				return candidate;
+			}
+			return std::nullopt;
 		}
 
-		template<typename Ex, typename Map, typename... Ks>
-		std::string_view
-		findFirstOrElse(const Map & map, const std::string_view key, const Ks &... ks)
+		static_assert(lookupCgiVariable(SCRIPT_NAME) == CgiVariable::ScriptName);
+		static_assert(lookupCgiVariable(CONTENT_LENGTH) == CgiVariable::ContentLength);
+		static_assert(!lookupCgiVariable("SCRIPT_NAMES"));
+		static_assert(!lookupCgiVariable("SCRIPT_NAMX"));
+		static_assert(!lookupCgiVariable(""));
+
+		constexpr std::optional<HttpMethod>
+		parseHttpMethod(const std::string_view method)
 		{
-			if (const auto iter = map.find(key); iter != map.end()) {
-				return iter->second;
+			const auto is = [method](const std::string_view name, const HttpMethod value) -> std::optional<HttpMethod> {
+				if (method == name) {
+					return value;
+				}
+				return std::nullopt;
+			};
+			switch (method.length()) {
+				case 3:
+					return method.front() == 'G' ? is("GET", HttpMethod::GET) : is("PUT", HttpMethod::PUT);
+				case 4:
+					return method.front() == 'H' ? is("HEAD", HttpMethod::HEAD) : is("POST", HttpMethod::POST);
+				case 6:
+					return is("DELETE", HttpMethod::DELETE);
+				case 7:
+					return is("OPTIONS", HttpMethod::OPTIONS);
+				default:
+					return std::nullopt;
 			}
-			if constexpr (sizeof...(ks)) {
-				return findFirstOrElse<Ex>(map, ks...);
+		}
+
+		static_assert(parseHttpMethod("GET") == HttpMethod::GET);
+		static_assert(parseHttpMethod("PUT") == HttpMethod::PUT);
+		static_assert(parseHttpMethod("HEAD") == HttpMethod::HEAD);
+		static_assert(parseHttpMethod("POST") == HttpMethod::POST);
+		static_assert(parseHttpMethod("DELETE") == HttpMethod::DELETE);
+		static_assert(parseHttpMethod("OPTIONS") == HttpMethod::OPTIONS);
+		static_assert(!parseHttpMethod("PATCH"));
+		static_assert(!parseHttpMethod("GOT"));
+		static_assert(!parseHttpMethod("get"));
+
+		template<typename Out>
+		inline void
+		mapVars(const OptionalString & source, Out & map, const std::string_view separators,
+				std::pmr::memory_resource * arena)
+		{
+			map.emplace(arena);
+			if (source) {
+				XWwwFormUrlEncoded::iterateVars(
+						*source,
+						[&map](auto && key, auto && value) {
+							map->append(std::forward<decltype(key)>(key), std::forward<decltype(value)>(value));
+						},
+						separators, arena);
+				map->sort();
 			}
-			throw Ex();
 		}
 
 		template<typename Fmt, typename Map>
@@ -77,23 +162,67 @@ namespace IceSpider {
 		for (const auto & envdata : {envs, extra}) {
 			for (const std::string_view env : envdata) {
 				if (const auto equalPos = env.find('='); equalPos != std::string_view::npos) {
-					envmap.emplace(env.substr(0, equalPos), env.substr(equalPos + 1));
+					const auto key = env.substr(0, equalPos);
+					const auto value = env.substr(equalPos + 1);
+					envmap.append(key, value);
+					if (const auto variable = lookupCgiVariable(key)) {
+						cgiVariables[static_cast<std::size_t>(*variable)] = value;
+					}
 				}
 			}
 		}
+		envmap.sort();
+		if (const auto method = getCgiVariable(CgiVariable::RequestMethod)) {
+			requestMethod = parseHttpMethod(*method);
+		}
 
-		if (auto path = findFirstOrElse<Http400BadRequest>(envmap, REDIRECT_URL, SCRIPT_NAME).substr(1);
-				// NOLINTNEXTLINE(clang-analyzer-cplusplus.NewDeleteLeaks)
-				!path.empty()) {
-			ba::split(pathElements, path, SLASH_PRED, ba::token_compress_off);
+		auto requestPath = getCgiVariable(CgiVariable::RedirectUrl);
+		if (!requestPath) {
+			requestPath = getCgiVariable(CgiVariable::ScriptName);
+		}
+		if (!requestPath) {
+			throw Http400BadRequest();
 		}
+		if (auto path = requestPath->substr(1); !path.empty()) {
+			// Split in place rather than with ba::split, which would swap in a vector from the default resource
+			for (auto slash = path.find('/'); slash != std::string_view::npos; slash = path.find('/')) {
+				pathElements.emplace_back(path.substr(0, slash));
+				path.remove_prefix(slash + 1);
+			}
+			pathElements.emplace_back(path);
+		}
+	}
+
+	const CgiRequestBase::StrMap &
+	CgiRequestBase::getQueryStringMap() const
+	{
+		if (!qsmap) {
+			mapVars(getCgiVariable(CgiVariable::QueryString), qsmap, AMP, &arena);
+		}
+		return *qsmap;
+	}
 
-		mapVars(QUERY_STRING, envmap, qsmap, AMP);
-		mapVars(HTTP_COOKIE, envmap, cookiemap, SEMI);
-		for (auto header = envmap.lower_bound(HEADER_PREFIX);
-				header != envmap.end() && ba::starts_with(header->first, HEADER_PREFIX); header++) {
-			hdrmap.insert({header->first.substr(HEADER_PREFIX.length()), header->second});
+	const CgiRequestBase::StrMap &
+	CgiRequestBase::getCookieMap() const
+	{
+		if (!cookiemap) {
+			mapVars(getCgiVariable(CgiVariable::HttpCookie), cookiemap, SEMI, &arena);
 		}
+		return *cookiemap;
+	}
+
+	const CgiRequestBase::HdrMap &
+	CgiRequestBase::getHeaderMap() const
+	{
+		if (!hdrmap) {
+			hdrmap.emplace(&arena);
+			for (auto header = envmap.lower_bound(HEADER_PREFIX);
+					header != envmap.end() && ba::starts_with(header->first, HEADER_PREFIX); header++) {
+				hdrmap->append(header->first.substr(HEADER_PREFIX.length()), header->second);
+			}
+			hdrmap->sort();
+		}
+		return *hdrmap;
 	}
 
 	AdHocFormatter(VarFmt, "\t%?: [%?]\n");
@@ -107,8 +236,8 @@ namespace IceSpider {
 		for (const auto & element : pathElements) {
 			PathFmt::write(strm, element);
 		}
-		dumpMap<VarFmt>(strm, "Query string dump"sv, qsmap);
-		dumpMap<VarFmt>(strm, "Cookie dump"sv, cookiemap);
+		dumpMap<VarFmt>(strm, "Query string dump"sv, getQueryStringMap());
+		dumpMap<VarFmt>(strm, "Cookie dump"sv, getCookieMap());
 		return strm;
 	}
 
@@ -138,46 +267,70 @@ namespace IceSpider {
 	HttpMethod
 	CgiRequestBase::getRequestMethod() const
 	{
-		try {
-			auto iter = envmap.find(REQUEST_METHOD);
-			if (iter == envmap.end()) {
-				throw IceSpider::Http400BadRequest();
-			}
-			return Slicer::ModelPartForEnum<HttpMethod>::lookup(iter->second);
+		if (requestMethod) {
+			return *requestMethod;
 		}
-		catch (const Slicer::InvalidEnumerationSymbol &) {
-			throw IceSpider::Http405MethodNotAllowed();
+		if (!hasRequestMethod()) {
+			throw IceSpider::Http400BadRequest();
 		}
+		throw IceSpider::Http405MethodNotAllowed();
+	}
+
+	std::optional<HttpMethod>
+	CgiRequestBase::findRequestMethod() const
+	{
+		return requestMethod;
+	}
+
+	bool
+	CgiRequestBase::hasRequestMethod() const
+	{
+		return getCgiVariable(CgiVariable::RequestMethod).has_value();
 	}
 
 	OptionalString
 	CgiRequestBase::getQueryStringParamStr(const std::string_view key) const
 	{
-		return optionalLookup(key, qsmap);
+		return optionalLookup(key, getQueryStringMap());
 	}
 
 	OptionalString
 	CgiRequestBase::getCookieParamStr(const std::string_view key) const
 	{
-		return optionalLookup(key, cookiemap);
+		return optionalLookup(key, getCookieMap());
 	}
 
 	OptionalString
 	CgiRequestBase::getEnvStr(const std::string_view key) const
 	{
+		if (const auto variable = lookupCgiVariable(key)) {
+			return getCgiVariable(*variable);
+		}
 		return optionalLookup(key, envmap);
 	}
 
+	OptionalString
+	CgiRequestBase::getContentType() const
+	{
+		return getCgiVariable(CgiVariable::ContentType);
+	}
+
+	OptionalString
+	CgiRequestBase::getCgiVariable(const CgiVariable variable) const
+	{
+		return cgiVariables[static_cast<std::size_t>(variable)];
+	}
+
 	bool
 	CgiRequestBase::isSecure() const
 	{
-		return envmap.contains(HTTPS);
+		return getCgiVariable(CgiVariable::Https).has_value();
 	}
 
 	OptionalString
 	CgiRequestBase::getHeaderParamStr(const std::string_view key) const
 	{
-		return optionalLookup(key, hdrmap);
+		return optionalLookup(key, getHeaderMap());
 	}
 
 	void
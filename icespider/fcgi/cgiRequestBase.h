@@ -1,11 +1,16 @@
 #pragma once
 
+#include <array>
 #include <case_less.h>
+#include <cstddef>
+#include <cstdint>
 #include <flatMap.h>
 #include <http.h>
 #include <ihttpRequest.h>
 #include <iosfwd>
 #include <maybeString.h>
+#include <memory_resource>
+#include <optional>
 #include <span>
 #include <string_view>
 
@@ -23,17 +28,34 @@ namespace IceSpider {
 		CgiRequestBase(Core * core, EnvArray envs, EnvArray extra = {});
 
 	public:
-		using VarMap = FlatMap<std::string_view, std::string_view>;
-		using HdrMap = FlatMap<std::string_view, std::string_view, AdHoc::case_less>;
-		using StrMap = FlatMap<MaybeString, MaybeString>;
+		using VarMap = pmr::FlatMap<std::string_view, std::string_view>;
+		using HdrMap = pmr::FlatMap<std::string_view, std::string_view, AdHoc::case_less>;
+		using StrMap = pmr::FlatMap<MaybeString, MaybeString>;
+
+		// Standard CGI variables, found in the single pass over the environment and held in fixed slots
+		enum class CgiVariable : uint8_t {
+			ContentLength,
+			ContentType,
+			Https,
+			HttpCookie,
+			QueryString,
+			RedirectUrl,
+			RequestMethod,
+			ScriptName,
+		};
+
+		[[nodiscard]] OptionalString getCgiVariable(CgiVariable variable) const;
 
 		[[nodiscard]] const PathElements & getRequestPath() const override;
 		[[nodiscard]] PathElements & getRequestPath() override;
 		[[nodiscard]] HttpMethod getRequestMethod() const override;
+		[[nodiscard]] std::optional<HttpMethod> findRequestMethod() const override;
+		[[nodiscard]] bool hasRequestMethod() const override;
 		[[nodiscard]] OptionalString getQueryStringParamStr(std::string_view key) const override;
 		[[nodiscard]] OptionalString getHeaderParamStr(std::string_view key) const override;
 		[[nodiscard]] OptionalString getCookieParamStr(std::string_view key) const override;
 		[[nodiscard]] OptionalString getEnvStr(std::string_view key) const override;
+		[[nodiscard]] OptionalString getContentType() const override;
 		[[nodiscard]] bool isSecure() const override;
 
 		void response(short, std::string_view) const override;
@@ -42,12 +64,27 @@ namespace IceSpider {
 		std::ostream & dump(std::ostream & strm) const override;
 
 	private:
+		static constexpr std::size_t CGI_VARIABLE_COUNT = static_cast<std::size_t>(CgiVariable::ScriptName) + 1;
+
 		template<typename MapType> static OptionalString optionalLookup(std::string_view key, const MapType &);
 
-		VarMap envmap {40};
-		StrMap qsmap;
-		StrMap cookiemap;
-		HdrMap hdrmap {15};
-		PathElements pathElements;
+		// Query string, cookies and headers are only parsed when first asked for
+		[[nodiscard]] const StrMap & getQueryStringMap() const;
+		[[nodiscard]] const StrMap & getCookieMap() const;
+		[[nodiscard]] const HdrMap & getHeaderMap() const;
+
+		// Request scoped storage for the maps, path and decoded values below, released in one go
+		static constexpr std::size_t ARENA_SIZE = 4096;
+		std::array<std::byte, ARENA_SIZE> arenaBuffer;
+		mutable std::pmr::monotonic_buffer_resource arena {arenaBuffer.data(), arenaBuffer.size()};
+
+		VarMap envmap {40, &arena};
+		std::array<OptionalString, CGI_VARIABLE_COUNT> cgiVariables;
+		// Parsed once, empty when the method is missing or not one we support
+		std::optional<HttpMethod> requestMethod;
+		mutable std::optional<StrMap> qsmap;
+		mutable std::optional<StrMap> cookiemap;
+		mutable std::optional<HdrMap> hdrmap;
+		PathElements pathElements {&arena};
 	};
 }
@@ -0,0 +1,21 @@
+#include "fcgiNativeRequest.h"
+
+namespace IceSpider {
+	FcgiNativeRequest::FcgiNativeRequest(
+			Core * core, EnvArray env, std::span<char> body, std::streambuf * outputbuf) :
+		CgiRequestBase(core, env), input(body), output(outputbuf)
+	{
+	}
+
+	std::istream &
+	FcgiNativeRequest::getInputStream() const
+	{
+		return input;
+	}
+
+	std::ostream &
+	FcgiNativeRequest::getOutputStream() const
+	{
+		return output;
+	}
+}
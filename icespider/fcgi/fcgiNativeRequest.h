@@ -0,0 +1,26 @@
+#pragma once
+
+#include "cgiRequestBase.h"
+#include <iosfwd>
+#include <ostream>
+#include <span>
+#include <spanstream>
+#include <streambuf>
+
+namespace IceSpider {
+	class Core;
+
+	// A request read in full by FcgiServer; the body is served from memory and
+	// the output is framed into FCGI_STDOUT records by the supplied buffer.
+	class FcgiNativeRequest : public CgiRequestBase {
+	public:
+		FcgiNativeRequest(Core * core, EnvArray env, std::span<char> body, std::streambuf * outputbuf);
+
+		std::istream & getInputStream() const override;
+		std::ostream & getOutputStream() const override;
+
+	private:
+		mutable std::ispanstream input;
+		mutable std::ostream output;
+	};
+}
@@ -0,0 +1,743 @@
+#include "fcgiNativeServer.h"
+#include "fcgiNativeRequest.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <core.h>
+#include <exceptions.h>
+#include <fcntl.h>
+#include <formatters.h>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace IceSpider {
+	namespace {
+		constexpr std::size_t READ_CHUNK = 65536;
+		constexpr std::size_t OUTPUT_BUFFER = 32768;
+		// Stop reading further requests while this much output is waiting for the web server to take it
+		constexpr std::size_t OUTPUT_HIGH_WATER = 1024UL * 1024UL;
+		constexpr int MAX_EVENTS = 64;
+		// As advertised in FCGI_MAX_REQS
+		constexpr std::size_t MAX_REQUESTS = 1024;
+		// A request's params are its headers and CGI variables; far more than any web server will send
+		constexpr std::size_t MAX_PARAMS = 1024 * 1024;
+		// The longest record possible; consume never leaves more than one partial record behind
+		constexpr std::size_t MAX_RECORD_LEN = 8 + 0xffff + 0xff;
+		// How long to stop accepting when out of file descriptors, rather than spin on a listen socket which stays
+		// readable
+		constexpr std::chrono::milliseconds ACCEPT_BACKOFF {100};
+		constexpr auto CONTENT_LENGTH = "CONTENT_LENGTH";
+		constexpr auto MAX_CONNS = "FCGI_MAX_CONNS";
+		constexpr auto MAX_REQS = "FCGI_MAX_REQS";
+		constexpr auto MPXS_CONNS = "FCGI_MPXS_CONNS";
+
+		[[noreturn]] void
+		throwErrno(const char * what)
+		{
+			throw std::system_error(errno, std::generic_category(), what);
+		}
+
+		uint8_t
+		byteAt(std::string_view bytes, std::size_t offset)
+		{
+			return static_cast<uint8_t>(bytes[offset]);
+		}
+
+		uint16_t
+		readUint16(std::string_view bytes, std::size_t offset)
+		{
+			return static_cast<uint16_t>((byteAt(bytes, offset) << 8U) | byteAt(bytes, offset + 1));
+		}
+
+		// Name-value pair lengths are 1 byte, or 4 bytes with the top bit set
+		bool
+		readLength(std::string_view & bytes, std::size_t & length)
+		{
+			if (bytes.empty()) {
+				return false;
+			}
+			if (const auto first = byteAt(bytes, 0); (first & 0x80U) == 0) {
+				length = first;
+				bytes.remove_prefix(1);
+				return true;
+			}
+			constexpr std::size_t LONG_LENGTH = 4;
+			if (bytes.size() < LONG_LENGTH) {
+				return false;
+			}
+			length = (static_cast<std::size_t>(byteAt(bytes, 0) & 0x7fU) << 24U)
+					| (static_cast<std::size_t>(byteAt(bytes, 1)) << 16U)
+					| (static_cast<std::size_t>(byteAt(bytes, 2)) << 8U) | byteAt(bytes, 3);
+			bytes.remove_prefix(LONG_LENGTH);
+			return true;
+		}
+
+		template<typename Handler>
+		void
+		iterateNameValues(std::string_view bytes, const Handler & handler)
+		{
+			std::size_t nameLength {}, valueLength {};
+			while (readLength(bytes, nameLength) && readLength(bytes, valueLength)
+					&& bytes.size() >= nameLength + valueLength) {
+				handler(bytes.substr(0, nameLength), bytes.substr(nameLength, valueLength));
+				bytes.remove_prefix(nameLength + valueLength);
+			}
+		}
+
+		std::optional<std::size_t>
+		contentLength(std::string_view params)
+		{
+			std::optional<std::size_t> length;
+			iterateNameValues(params, [&length](auto name, auto value) {
+				if (std::size_t parsed {}; name == CONTENT_LENGTH
+						&& std::from_chars(value.data(), value.data() + value.size(), parsed).ec == std::errc {}) {
+					length = parsed;
+				}
+			});
+			return length;
+		}
+
+		void
+		appendLength(std::string & out, std::size_t length)
+		{
+			if (length < 0x80U) {
+				out += static_cast<char>(length);
+			}
+			else {
+				out += static_cast<char>(((length >> 24U) & 0x7fU) | 0x80U);
+				out += static_cast<char>((length >> 16U) & 0xffU);
+				out += static_cast<char>((length >> 8U) & 0xffU);
+				out += static_cast<char>(length & 0xffU);
+			}
+		}
+
+		// Frames everything written to it as FCGI_STDOUT records on the connection's
+		// output buffer.
+		class RecordStreamBuf : public std::streambuf {
+		public:
+			RecordStreamBuf(std::string & out, uint16_t requestId) : out {out}, requestId {requestId}
+			{
+				setp(buffer.data(), buffer.data() + buffer.size());
+			}
+
+			void
+			close()
+			{
+				emit();
+				Fcgi::appendRecord(out, Fcgi::RecordType::Stdout, requestId, {});
+			}
+
+		protected:
+			int_type
+			overflow(int_type chr) override
+			{
+				emit();
+				if (!traits_type::eq_int_type(chr, traits_type::eof())) {
+					*pptr() = traits_type::to_char_type(chr);
+					pbump(1);
+				}
+				return traits_type::not_eof(chr);
+			}
+
+			int
+			sync() override
+			{
+				emit();
+				return 0;
+			}
+
+		private:
+			void
+			emit()
+			{
+				if (pptr() != pbase()) {
+					Fcgi::appendRecord(out, Fcgi::RecordType::Stdout, requestId, {pbase(), pptr()});
+					setp(buffer.data(), buffer.data() + buffer.size());
+				}
+			}
+
+			std::string & out;
+			uint16_t requestId;
+			std::array<char, OUTPUT_BUFFER> buffer {};
+		};
+	}
+
+	// Everything a request needs while it may be running on an Ice thread; its
+	// output is kept apart from the connection's until it's handed back.
+	class FcgiActiveRequest {
+	public:
+		FcgiActiveRequest(std::weak_ptr<FcgiConnection> connection, FcgiCompletionQueuePtr completions,
+				uint16_t requestId, bool keepConnection, std::string body) :
+			connection {std::move(connection)}, completions {std::move(completions)},
+			loopThread {std::this_thread::get_id()}, requestId {requestId}, keepConnection {keepConnection},
+			body {std::move(body)}, outputBuf {output, requestId}
+		{
+		}
+
+		const std::weak_ptr<FcgiConnection> connection;
+		const FcgiCompletionQueuePtr completions;
+		const std::thread::id loopThread;
+		const uint16_t requestId;
+		const bool keepConnection;
+		std::string envStorage;
+		std::vector<const char *> env;
+		std::string body;
+		std::string output;
+		RecordStreamBuf outputBuf;
+		std::optional<FcgiNativeRequest> request;
+	};
+
+	void
+	Fcgi::appendRecord(std::string & out, RecordType type, uint16_t requestId, std::string_view content)
+	{
+		do {
+			const auto chunk = content.substr(0, MAX_CONTENT_LEN);
+			const auto padding = (HEADER_LEN - (chunk.size() % HEADER_LEN)) % HEADER_LEN;
+			const std::array<char, HEADER_LEN> header {
+					static_cast<char>(VERSION_1),
+					static_cast<char>(type),
+					static_cast<char>(requestId >> 8U),
+					static_cast<char>(requestId & 0xffU),
+					static_cast<char>(chunk.size() >> 8U),
+					static_cast<char>(chunk.size() & 0xffU),
+					static_cast<char>(padding),
+					0,
+			};
+			out.append(header.data(), header.size());
+			out.append(chunk);
+			out.append(padding, '\0');
+			content.remove_prefix(chunk.size());
+		} while (!content.empty());
+	}
+
+	void
+	Fcgi::appendNameValue(std::string & out, std::string_view name, std::string_view value)
+	{
+		appendLength(out, name.size());
+		appendLength(out, value.size());
+		out.append(name);
+		out.append(value);
+	}
+
+	FcgiCompletionQueue::FcgiCompletionQueue() : eventFd {::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}
+	{
+		if (eventFd < 0) {
+			throwErrno("eventfd");
+		}
+	}
+
+	FcgiCompletionQueue::~FcgiCompletionQueue()
+	{
+		::close(eventFd);
+	}
+
+	void
+	FcgiCompletionQueue::post(std::shared_ptr<FcgiActiveRequest> request)
+	{
+		bool wake {};
+		{
+			const std::lock_guard guard {lock};
+			wake = completed.empty();
+			completed.push_back(std::move(request));
+		}
+		if (wake) {
+			::eventfd_write(eventFd, 1);
+		}
+	}
+
+	FcgiCompletionQueue::Completed
+	FcgiCompletionQueue::take()
+	{
+		eventfd_t count {};
+		::eventfd_read(eventFd, &count);
+		const std::lock_guard guard {lock};
+		return std::exchange(completed, {});
+	}
+
+	int
+	FcgiCompletionQueue::getFd() const
+	{
+		return eventFd;
+	}
+
+	FcgiConnection::FcgiConnection(Core & core, int fd, FcgiCompletionQueuePtr completions) :
+		core {core}, fd {fd}, completions {std::move(completions)}
+	{
+	}
+
+	FcgiConnection::~FcgiConnection()
+	{
+		::close(fd);
+	}
+
+	int
+	FcgiConnection::getFd() const
+	{
+		return fd;
+	}
+
+	FcgiConnection::Interest
+	FcgiConnection::onReadable()
+	{
+		ssize_t bytes {};
+		const auto existing = inbuf.size();
+		inbuf.resize_and_overwrite(existing + READ_CHUNK, [this, existing, &bytes](char * data, std::size_t) {
+			bytes = ::recv(fd, data + existing, READ_CHUNK, 0);
+			return existing + static_cast<std::size_t>(std::max<ssize_t>(bytes, 0));
+		});
+		if (bytes == 0) {
+			// Web server has sent all it will; answer what it's asked for already, then close
+			endOfInput = true;
+			closeWhenFlushed = true;
+			return flush() ? interest() : Interest::Close;
+		}
+		if (bytes < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				return interest();
+			}
+			// Web server went away; there's no one left to answer
+			return Interest::Close;
+		}
+		if (!consume() || !flush()) {
+			return Interest::Close;
+		}
+		return interest();
+	}
+
+	FcgiConnection::Interest
+	FcgiConnection::onWritable()
+	{
+		if (!flush()) {
+			return Interest::Close;
+		}
+		return interest();
+	}
+
+	FcgiConnection::Interest
+	FcgiConnection::interest() const
+	{
+		const auto unsent = outbuf.size() - outpos;
+		if (unsent == 0 && closeWhenFlushed && inFlight.empty()) {
+			return Interest::Close;
+		}
+		if (endOfInput || unsent > OUTPUT_HIGH_WATER) {
+			return unsent > 0 ? Interest::Write : Interest::None;
+		}
+		return unsent > 0 ? Interest::ReadWrite : Interest::Read;
+	}
+
+	bool
+	FcgiConnection::consume()
+	{
+		std::string_view available {inbuf};
+		while (available.size() >= Fcgi::HEADER_LEN) {
+			if (byteAt(available, 0) != Fcgi::VERSION_1) {
+				return false;
+			}
+			const auto contentLength = readUint16(available, 4);
+			const auto recordLength = Fcgi::HEADER_LEN + contentLength + byteAt(available, 6);
+			if (available.size() < recordLength) {
+				break;
+			}
+			processRecord(static_cast<Fcgi::RecordType>(byteAt(available, 1)), readUint16(available, 2),
+					available.substr(Fcgi::HEADER_LEN, contentLength));
+			available.remove_prefix(recordLength);
+		}
+		inbuf.erase(0, inbuf.size() - available.size());
+		return inbuf.size() <= MAX_RECORD_LEN;
+	}
+
+	void
+	FcgiConnection::processRecord(Fcgi::RecordType type, uint16_t requestId, std::string_view content)
+	{
+		if (requestId == Fcgi::NULL_REQUEST_ID) {
+			if (type == Fcgi::RecordType::GetValues) {
+				processGetValues(content);
+			}
+			else {
+				const std::array<char, Fcgi::HEADER_LEN> unknown {static_cast<char>(type)};
+				Fcgi::appendRecord(
+						outbuf, Fcgi::RecordType::UnknownType, requestId, {unknown.data(), unknown.size()});
+			}
+			return;
+		}
+
+		switch (type) {
+			case Fcgi::RecordType::BeginRequest: {
+				constexpr std::size_t BEGIN_REQUEST_LEN = 8;
+				// A request can't begin again until it's ended
+				if (content.size() < BEGIN_REQUEST_LEN || requests.contains(requestId)
+						|| inFlight.contains(requestId)) {
+					return;
+				}
+				const bool keepConnection = (byteAt(content, 2) & Fcgi::FLAG_KEEP_CONN) != 0;
+				if (readUint16(content, 0) != Fcgi::ROLE_RESPONDER) {
+					endRequest(requestId, Fcgi::ProtocolStatus::UnknownRole);
+					closeWhenFlushed = closeWhenFlushed || !keepConnection;
+					return;
+				}
+				if (requests.size() + inFlight.size() >= MAX_REQUESTS) {
+					endRequest(requestId, Fcgi::ProtocolStatus::Overloaded);
+					closeWhenFlushed = closeWhenFlushed || !keepConnection;
+					return;
+				}
+				requests.try_emplace(requestId, keepConnection);
+				return;
+			}
+			case Fcgi::RecordType::AbortRequest:
+				if (requests.erase(requestId) != 0) {
+					endRequest(requestId, Fcgi::ProtocolStatus::RequestComplete);
+				}
+				return;
+			case Fcgi::RecordType::Params:
+				if (const auto request = requests.find(requestId); request != requests.end()) {
+					auto & pending = request->second;
+					if (content.empty()) {
+						pending.paramsComplete = true;
+						// Refuse a declared body which is too large before any of it is buffered; bodies are held in
+						// memory here, so maxBodySize applies even to multipart ones
+						if (const auto length = contentLength(pending.params); length && *length > core.maxBodySize) {
+							reject(request, Http413PayloadTooLarge::CODE, Http413PayloadTooLarge::MESSAGE);
+						}
+					}
+					else if (pending.params.size() + content.size() > MAX_PARAMS) {
+						reject(request, Http400BadRequest::CODE, Http400BadRequest::MESSAGE);
+					}
+					else {
+						pending.params.append(content);
+					}
+				}
+				return;
+			case Fcgi::RecordType::Stdin:
+				if (const auto request = requests.find(requestId); request != requests.end()) {
+					if (content.empty()) {
+						auto pending = std::move(request->second);
+						requests.erase(request);
+						runRequest(requestId, std::move(pending));
+					}
+					else if (request->second.body.size() + content.size() > core.maxBodySize) {
+						reject(request, Http413PayloadTooLarge::CODE, Http413PayloadTooLarge::MESSAGE);
+					}
+					else {
+						request->second.body.append(content);
+					}
+				}
+				return;
+			default:
+				// Data and management records addressed to a request are not used by responders
+				return;
+		}
+	}
+
+	void
+	FcgiConnection::processGetValues(std::string_view content)
+	{
+		std::string values;
+		iterateNameValues(content, [&values](auto name, auto) {
+			if (name == MAX_CONNS || name == MAX_REQS) {
+				Fcgi::appendNameValue(values, name, "1024");
+			}
+			else if (name == MPXS_CONNS) {
+				Fcgi::appendNameValue(values, name, "1");
+			}
+		});
+		Fcgi::appendRecord(outbuf, Fcgi::RecordType::GetValuesResult, Fcgi::NULL_REQUEST_ID, values);
+	}
+
+	void
+	FcgiConnection::runRequest(uint16_t requestId, PendingRequest && pending)
+	{
+		auto active = std::make_shared<FcgiActiveRequest>(
+				weak_from_this(), completions, requestId, pending.keepConnection, std::move(pending.body));
+		// CgiRequestBase wants a NAME=VALUE environment; build it in one buffer
+		auto & envStorage = active->envStorage;
+		envStorage.reserve(pending.params.size() + (pending.params.size() / 4));
+		std::vector<std::size_t> envOffsets;
+		iterateNameValues(pending.params, [&envStorage, &envOffsets](auto name, auto value) {
+			envOffsets.push_back(envStorage.size());
+			envStorage.append(name);
+			envStorage += '=';
+			envStorage.append(value);
+			envStorage += '\0';
+		});
+		active->env.reserve(envOffsets.size());
+		for (const auto offset : envOffsets) {
+			active->env.push_back(envStorage.c_str() + offset);
+		}
+
+		try {
+			active->request.emplace(&core, active->env, active->body, &active->outputBuf);
+		}
+		catch (const HttpException & he) {
+			std::ostream strm {&active->outputBuf};
+			StatusFmt::write(strm, he.code, he.message);
+			inFlight.insert(requestId);
+			complete(*active);
+			return;
+		}
+		catch (...) {
+			std::ostream strm {&active->outputBuf};
+			StatusFmt::write(strm, Http500InternalServerError::CODE, Http500InternalServerError::MESSAGE);
+			inFlight.insert(requestId);
+			complete(*active);
+			return;
+		}
+
+		inFlight.insert(requestId);
+		core.processAsync(&*active->request, [active]() {
+			if (std::this_thread::get_id() == active->loopThread) {
+				// Completed synchronously, we're still on the loop thread
+				if (const auto connection = active->connection.lock()) {
+					connection->complete(*active);
+				}
+			}
+			else {
+				active->completions->post(active);
+			}
+		});
+	}
+
+	void
+	FcgiConnection::reject(Requests::iterator request, short code, const std::string & message)
+	{
+		const auto requestId = request->first;
+		closeWhenFlushed = closeWhenFlushed || !request->second.keepConnection;
+		// Anything else the web server sends for it is for a request which no longer exists, and is discarded
+		requests.erase(request);
+		RecordStreamBuf outputBuf {outbuf, requestId};
+		std::ostream strm {&outputBuf};
+		StatusFmt::write(strm, code, message);
+		outputBuf.close();
+		endRequest(requestId, Fcgi::ProtocolStatus::RequestComplete);
+	}
+
+	void
+	FcgiConnection::complete(FcgiActiveRequest & active)
+	{
+		active.outputBuf.close();
+		if (outbuf.empty()) {
+			outbuf.swap(active.output);
+		}
+		else {
+			outbuf.append(active.output);
+		}
+		endRequest(active.requestId, Fcgi::ProtocolStatus::RequestComplete);
+		inFlight.erase(active.requestId);
+		closeWhenFlushed = closeWhenFlushed || !active.keepConnection;
+	}
+
+	void
+	FcgiConnection::endRequest(uint16_t requestId, Fcgi::ProtocolStatus status)
+	{
+		const std::array<char, Fcgi::HEADER_LEN> endRequestBody {0, 0, 0, 0, static_cast<char>(status)};
+		Fcgi::appendRecord(outbuf, Fcgi::RecordType::EndRequest, requestId,
+				{endRequestBody.data(), endRequestBody.size()});
+	}
+
+	bool
+	FcgiConnection::flush()
+	{
+		while (outpos < outbuf.size()) {
+			const auto bytes = ::send(fd, outbuf.data() + outpos, outbuf.size() - outpos, MSG_NOSIGNAL);
+			if (bytes < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					return true;
+				}
+				return false;
+			}
+			outpos += static_cast<std::size_t>(bytes);
+		}
+		outbuf.clear();
+		outpos = 0;
+		return true;
+	}
+
+	FcgiServer::FcgiServer(Core & core, int listenFd) :
+		core {core}, listenFd {listenFd}, stopFd {::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}
+	{
+		if (stopFd < 0) {
+			throwErrno("eventfd");
+		}
+		if (::fcntl(listenFd, F_SETFL, ::fcntl(listenFd, F_GETFL) | O_NONBLOCK) < 0) {
+			::close(stopFd);
+			throwErrno("fcntl");
+		}
+	}
+
+	FcgiServer::~FcgiServer()
+	{
+		::close(stopFd);
+	}
+
+	void
+	FcgiServer::stop()
+	{
+		// Never read, so it stays readable and wakes every loop
+		constexpr eventfd_t STOP = 1;
+		::eventfd_write(stopFd, STOP);
+	}
+
+	void
+	FcgiServer::run()
+	{
+		const auto epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd < 0) {
+			throwErrno("epoll_create1");
+		}
+		struct Watched {
+			std::shared_ptr<FcgiConnection> connection;
+			FcgiConnection::Interest interest {FcgiConnection::Interest::Read};
+		};
+
+		std::map<int, Watched> connections;
+		const auto completions = std::make_shared<FcgiCompletionQueue>();
+		const auto watch = [epollFd](int operation, int fd, uint32_t events) {
+			epoll_event event {};
+			event.events = events;
+			event.data.fd = fd;
+			if (::epoll_ctl(epollFd, operation, fd, &event) < 0) {
+				throwErrno("epoll_ctl");
+			}
+		};
+		const auto update = [epollFd, &connections, &watch](
+									int fd, Watched & watched, FcgiConnection::Interest interest) {
+			if (interest == watched.interest) {
+				return;
+			}
+			watched.interest = interest;
+			switch (interest) {
+				case FcgiConnection::Interest::Close:
+					::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+					connections.erase(fd);
+					break;
+				case FcgiConnection::Interest::None:
+					// Errors and hang ups are still reported
+					watch(EPOLL_CTL_MOD, fd, 0);
+					break;
+				case FcgiConnection::Interest::Read:
+					watch(EPOLL_CTL_MOD, fd, EPOLLIN | EPOLLRDHUP);
+					break;
+				case FcgiConnection::Interest::Write:
+					watch(EPOLL_CTL_MOD, fd, EPOLLOUT);
+					break;
+				case FcgiConnection::Interest::ReadWrite:
+					watch(EPOLL_CTL_MOD, fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP);
+					break;
+			}
+		};
+
+		// Set while accepting is paused, for want of file descriptors
+		std::optional<std::chrono::steady_clock::time_point> acceptResume;
+		const auto acceptTimeout = [&acceptResume]() {
+			if (!acceptResume) {
+				return -1;
+			}
+			const auto wait
+					= std::chrono::ceil<std::chrono::milliseconds>(*acceptResume - std::chrono::steady_clock::now());
+			return static_cast<int>(std::max<std::chrono::milliseconds::rep>(0, wait.count()));
+		};
+
+		try {
+			watch(EPOLL_CTL_ADD, stopFd, EPOLLIN);
+			watch(EPOLL_CTL_ADD, completions->getFd(), EPOLLIN);
+			// Exclusive so a new connection wakes one loop, not all of them
+			watch(EPOLL_CTL_ADD, listenFd, EPOLLIN | EPOLLEXCLUSIVE);
+
+			std::array<epoll_event, MAX_EVENTS> events {};
+			while (true) {
+				const auto count = ::epoll_wait(epollFd, events.data(), MAX_EVENTS, acceptTimeout());
+				if (acceptResume && std::chrono::steady_clock::now() >= *acceptResume) {
+					// Exclusive watches can't be modified, so pausing removed it and resuming adds it again
+					watch(EPOLL_CTL_ADD, listenFd, EPOLLIN | EPOLLEXCLUSIVE);
+					acceptResume.reset();
+				}
+				if (count < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					throwErrno("epoll_wait");
+				}
+				for (const auto & event : std::span {events.data(), static_cast<std::size_t>(count)}) {
+					const auto fd = event.data.fd;
+					if (fd == stopFd) {
+						for (const auto & connection : connections) {
+							::epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.first, nullptr);
+						}
+						connections.clear();
+						::close(epollFd);
+						return;
+					}
+					if (fd == completions->getFd()) {
+						for (const auto & request : completions->take()) {
+							if (const auto owner = request->connection.lock()) {
+								owner->complete(*request);
+								auto & watched = connections.at(owner->getFd());
+								update(owner->getFd(), watched, owner->onWritable());
+							}
+						}
+						continue;
+					}
+					if (fd == listenFd) {
+						while (true) {
+							const auto client = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+							if (client >= 0) {
+								connections.emplace(
+										client, Watched {std::make_shared<FcgiConnection>(core, client, completions)});
+								watch(EPOLL_CTL_ADD, client, EPOLLIN | EPOLLRDHUP);
+							}
+							else if (errno == EINTR || errno == ECONNABORTED) {
+								continue;
+							}
+							else {
+								const bool exhausted
+										= errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM;
+								if (exhausted && !acceptResume) {
+									::epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+									acceptResume = std::chrono::steady_clock::now() + ACCEPT_BACKOFF;
+								}
+								break;
+							}
+						}
+						continue;
+					}
+					const auto connection = connections.find(fd);
+					if (connection == connections.end()) {
+						continue;
+					}
+					auto & watched = connection->second;
+					auto interest = watched.interest;
+					if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+						interest = watched.connection->onReadable();
+					}
+					if (interest != FcgiConnection::Interest::Close && (event.events & EPOLLOUT)) {
+						interest = watched.connection->onWritable();
+					}
+					update(fd, watched, interest);
+				}
+			}
+		}
+		catch (...) {
+			connections.clear();
+			::close(epollFd);
+			throw;
+		}
+	}
+}
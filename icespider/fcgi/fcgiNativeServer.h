@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <visibility.h>
+
+namespace IceSpider {
+	class Core;
+	class FcgiActiveRequest;
+
+	namespace Fcgi {
+		constexpr uint8_t VERSION_1 = 1;
+		constexpr std::size_t HEADER_LEN = 8;
+		constexpr std::size_t MAX_CONTENT_LEN = 0xffff;
+		constexpr uint16_t NULL_REQUEST_ID = 0;
+		constexpr uint16_t ROLE_RESPONDER = 1;
+		constexpr uint8_t FLAG_KEEP_CONN = 1;
+
+		enum class RecordType : uint8_t {
+			BeginRequest = 1,
+			AbortRequest = 2,
+			EndRequest = 3,
+			Params = 4,
+			Stdin = 5,
+			Stdout = 6,
+			Stderr = 7,
+			Data = 8,
+			GetValues = 9,
+			GetValuesResult = 10,
+			UnknownType = 11,
+		};
+
+		enum class ProtocolStatus : uint8_t {
+			RequestComplete = 0,
+			CantMpxConn = 1,
+			Overloaded = 2,
+			UnknownRole = 3,
+		};
+
+		// Appends one record (or several, if content exceeds MAX_CONTENT_LEN)
+		// including padding to the next 8 byte boundary.
+		DLL_PUBLIC void appendRecord(std::string & out, RecordType, uint16_t requestId, std::string_view content);
+		DLL_PUBLIC void appendNameValue(std::string & out, std::string_view name, std::string_view value);
+	}
+
+	// Requests finished on Ice threads, handed back to the event loop which owns
+	// their connection; the loop watches getFd().
+	class DLL_PUBLIC FcgiCompletionQueue {
+	public:
+		using Completed = std::vector<std::shared_ptr<FcgiActiveRequest>>;
+
+		FcgiCompletionQueue();
+		~FcgiCompletionQueue();
+		FcgiCompletionQueue(const FcgiCompletionQueue &) = delete;
+		FcgiCompletionQueue(FcgiCompletionQueue &&) = delete;
+		FcgiCompletionQueue & operator=(const FcgiCompletionQueue &) = delete;
+		FcgiCompletionQueue & operator=(FcgiCompletionQueue &&) = delete;
+
+		void post(std::shared_ptr<FcgiActiveRequest>);
+		[[nodiscard]] Completed take();
+		[[nodiscard]] int getFd() const;
+
+	private:
+		std::mutex lock;
+		Completed completed;
+		int eventFd;
+	};
+
+	using FcgiCompletionQueuePtr = std::shared_ptr<FcgiCompletionQueue>;
+
+	// One web server connection; parses records, assembles requests and
+	// buffers output until the socket will take it. Only ever used by the
+	// event loop thread which accepted it.
+	class DLL_PUBLIC FcgiConnection : public std::enable_shared_from_this<FcgiConnection> {
+	public:
+		enum class Interest : uint8_t { None, Read, Write, ReadWrite, Close };
+
+		FcgiConnection(Core &, int fd, FcgiCompletionQueuePtr);
+		~FcgiConnection();
+		FcgiConnection(const FcgiConnection &) = delete;
+		FcgiConnection(FcgiConnection &&) = delete;
+		FcgiConnection & operator=(const FcgiConnection &) = delete;
+		FcgiConnection & operator=(FcgiConnection &&) = delete;
+
+		[[nodiscard]] Interest onReadable();
+		[[nodiscard]] Interest onWritable();
+		// Queue a finished request's output, called on the loop thread
+		void complete(FcgiActiveRequest &);
+
+		[[nodiscard]] int getFd() const;
+
+	private:
+		struct PendingRequest {
+			explicit PendingRequest(bool keepConnection) : keepConnection {keepConnection} { }
+
+			bool keepConnection;
+			bool paramsComplete {false};
+			std::string params;
+			std::string body;
+		};
+
+		using Requests = std::map<uint16_t, PendingRequest>;
+
+		[[nodiscard]] bool consume();
+		void processRecord(Fcgi::RecordType, uint16_t requestId, std::string_view content);
+		void processGetValues(std::string_view content);
+		void runRequest(uint16_t requestId, PendingRequest &&);
+		// Answer a request with just a status, without running it
+		void reject(Requests::iterator, short code, const std::string & message);
+		void endRequest(uint16_t requestId, Fcgi::ProtocolStatus);
+		[[nodiscard]] bool flush();
+		[[nodiscard]] Interest interest() const;
+
+		Core & core;
+		int fd;
+		FcgiCompletionQueuePtr completions;
+		std::string inbuf;
+		std::string outbuf;
+		std::size_t outpos {0};
+		// Requests running, from BeginRequest until their EndRequest is queued
+		std::set<uint16_t> inFlight;
+		bool closeWhenFlushed {false};
+		bool endOfInput {false};
+		Requests requests;
+	};
+
+	// Epoll based FastCGI responder. Each thread calling run gets its own event
+	// loop; all loops accept from the shared listen socket and keep the
+	// connections they accept.
+	class DLL_PUBLIC FcgiServer {
+	public:
+		FcgiServer(Core &, int listenFd);
+		~FcgiServer();
+		FcgiServer(const FcgiServer &) = delete;
+		FcgiServer(FcgiServer &&) = delete;
+		FcgiServer & operator=(const FcgiServer &) = delete;
+		FcgiServer & operator=(FcgiServer &&) = delete;
+
+		void run();
+		void stop();
+
+	private:
+		Core & core;
+		int listenFd;
+		int stopFd;
+	};
+}
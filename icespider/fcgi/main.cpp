@@ -1,28 +1,76 @@
 #include "cgiRequest.h"
+#include "fcgiNativeServer.h"
 #include "fcgiRequest.h"
+#include <Ice/Communicator.h>
+#include <Ice/Properties.h>
+#include <algorithm>
 #include <core.h>
 #include <fcgiapp.h>
+#include <functional>
 #include <http.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <visibility.h>
 
 using namespace IceSpider;
 
+namespace {
+	constexpr auto FCGI_THREADS = "IceSpider.Fcgi.Threads";
+	constexpr auto FCGI_ENGINE = "IceSpider.Fcgi.Engine";
+	constexpr auto FCGI_ENGINE_NATIVE = "native";
+	constexpr int FCGI_LISTENSOCK_FILENO = 0;
+
+	void
+	fcgiWorker(Core & core, std::mutex & acceptLock)
+	{
+		FCGX_Request request;
+		FCGX_InitRequest(&request, 0, 0);
+
+		while (true) {
+			{
+				// Not all platforms allow concurrent accept on the listen socket
+				const std::lock_guard lock {acceptLock};
+				if (FCGX_Accept_r(&request) != 0) {
+					break;
+				}
+			}
+			FcgiRequest req(&core, &request);
+			core.process(&req);
+			FCGX_Finish_r(&request);
+		}
+		FCGX_Free(&request, 1);
+	}
+}
+
 DLL_PUBLIC
 int
 main(int argc, char ** argv, char ** env)
 {
-	CoreWithDefaultRouter core;
+	CoreWithTrieRouter core;
 	if (!FCGX_IsCGI()) {
-		FCGX_Request request;
+		const auto properties = core.communicator->getProperties();
+		const auto threadCount = std::max(1, properties->getPropertyAsIntWithDefault(FCGI_THREADS, 1));
+		if (properties->getProperty(FCGI_ENGINE) == FCGI_ENGINE_NATIVE) {
+			FcgiServer server {core, FCGI_LISTENSOCK_FILENO};
+			std::vector<std::jthread> loops;
+			loops.reserve(static_cast<size_t>(threadCount - 1));
+			for (auto thread = 1; thread < threadCount; ++thread) {
+				loops.emplace_back(&FcgiServer::run, &server);
+			}
+			server.run();
+			return 0;
+		}
 
 		FCGX_Init();
-		FCGX_InitRequest(&request, 0, 0);
-
-		while (FCGX_Accept_r(&request) == 0) {
-			FcgiRequest req(&core, &request);
-			core.process(&req);
-			FCGX_Finish_r(&request);
+		std::mutex acceptLock;
+		std::vector<std::jthread> workers;
+		workers.reserve(static_cast<size_t>(threadCount - 1));
+		for (auto thread = 1; thread < threadCount; ++thread) {
+			workers.emplace_back(fcgiWorker, std::ref(core), std::ref(acceptLock));
 		}
+		fcgiWorker(core, acceptLock);
 	}
 	else {
 		CgiRequest req(&core, argc, argv, env);
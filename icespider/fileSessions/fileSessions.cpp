@@ -1,3 +1,4 @@
+#include "sessionCache.h"
 #include <Ice/Communicator.h>
 #include <Ice/Config.h>
 #include <Ice/Current.h>
@@ -5,10 +6,13 @@
 #include <Ice/OutputStream.h>
 #include <Ice/Properties.h>
 #include <Ice/PropertiesF.h>
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <core.h>
 #include <cstring>
 #include <ctime>
@@ -16,25 +20,49 @@
 #include <factory.impl.h>
 #include <fileUtils.h>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <session.h>
+#include <stop_token>
 #include <string>
 #include <string_view>
 #include <sys.h>
 #include <sys/file.h>
+#include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
 #include <utility>
 
 namespace IceSpider {
+	// Sessions are cached in memory as well as being written to files under Path. With Coherency=WriteThrough, the
+	// default, each change is written as it's made and each lookup checks the file is as it was cached, so several
+	// processes can share Path. With WriteBehind, this process must be Path's only user: lookups are served from memory
+	// and changes are written every WriteInterval milliseconds, and when the plugin is destroyed.
 	class FileSessions : public Plugin, public SessionManager {
 	public:
+		static constexpr int DEFAULT_CACHE_SIZE = 4096;
+		static constexpr int DEFAULT_WRITE_INTERVAL = 1000;
+		static constexpr std::string_view WRITE_BEHIND = "WriteBehind";
+
 		FileSessions(Ice::CommunicatorPtr com, const Ice::PropertiesPtr & props) :
 			ic(std::move(com)), root(props->getProperty("IceSpider.FileSessions.Path")),
 			duration(static_cast<Ice::Short>(
-					props->getPropertyAsIntWithDefault("IceSpider.FileSessions.Duration", 3600)))
+					props->getPropertyAsIntWithDefault("IceSpider.FileSessions.Duration", 3600))),
+			writeBehind(props->getProperty("IceSpider.FileSessions.Coherency") == WRITE_BEHIND),
+			cache(static_cast<std::size_t>(std::max(0,
+					props->getPropertyAsIntWithDefault("IceSpider.FileSessions.CacheSize", DEFAULT_CACHE_SIZE))))
 		{
 			if (!root.empty() && !std::filesystem::exists(root)) {
 				std::filesystem::create_directories(root);
 			}
+			if (writeBehind) {
+				const std::chrono::milliseconds interval {std::max(1,
+						props->getPropertyAsIntWithDefault(
+								"IceSpider.FileSessions.WriteInterval", DEFAULT_WRITE_INTERVAL))};
+				writer = std::jthread {[this, interval](const std::stop_token & stop) {
+					writeBack(stop, interval);
+				}};
+			}
 		}
 
 		FileSessions(const FileSessions &) = delete;
@@ -43,6 +71,12 @@ namespace IceSpider {
 		~FileSessions() override
 		{
 			try {
+				// Stopped first, so nothing is written after the final flush
+				if (writer.joinable()) {
+					writer.request_stop();
+					writer.join();
+				}
+				flush();
 				removeExpired();
 			}
 			catch (...) { // NOLINT(bugprone-empty-catch) - Meh :)
@@ -59,6 +93,7 @@ namespace IceSpider {
 			// NOLINTNEXTLINE(clang-analyzer-optin.cplusplus.VirtualCall)
 			session->id = boost::lexical_cast<std::string>(boost::uuids::random_generator()());
 			session->duration = duration;
+			// Written straight away in either mode, so the file exists as soon as the id is handed out
 			save(session);
 			return session;
 		}
@@ -66,7 +101,7 @@ namespace IceSpider {
 		SessionPtr
 		getSession(const ::std::string sessionId, const ::Ice::Current & current) override
 		{
-			auto session = load(sessionId);
+			auto session = find(sessionId);
 			if (session && isExpired(session)) {
 				destroySession(sessionId, current);
 				return nullptr;
@@ -77,12 +112,23 @@ namespace IceSpider {
 		void
 		updateSession(const SessionPtr session, const ::Ice::Current &) override
 		{
-			save(session);
+			if (writeBehind) {
+				session->lastUsed = time(nullptr);
+				// Not during a destroy, which could otherwise leave it cached, and written back, once its file is gone
+				const std::lock_guard guard {writeLock};
+				cache.insert(session, std::nullopt, true);
+			}
+			else {
+				save(session);
+			}
 		}
 
 		void
 		destroySession(const ::std::string sessionId, const ::Ice::Current &) override
 		{
+			// Not during a write back, which could otherwise put the file back
+			const std::lock_guard guard {writeLock};
+			cache.erase(sessionId);
 			try {
 				std::filesystem::remove(root / sessionId);
 			}
@@ -92,10 +138,22 @@ namespace IceSpider {
 		}
 
 	private:
+		// Changes more recent than this might not have moved a file's timestamps on, depending on the file system's
+		// granularity, so a stamp read any sooner after one, perhaps by another process, can't be trusted to identify
+		// its content
+		static constexpr std::chrono::seconds RACY_WINDOW {2};
+
 		void
 		save(const SessionPtr & session)
 		{
 			session->lastUsed = time(nullptr);
+			// Taken under the write's own lock, so it describes exactly what was written
+			cache.insert(session, write(session), false);
+		}
+
+		FileStamp
+		write(const SessionPtr & session)
+		{
 			Ice::OutputStream buf(ic);
 			buf.write(session);
 			const auto range = buf.finished();
@@ -104,16 +162,45 @@ namespace IceSpider {
 			sysassert(flock(sessionFile.fh, LOCK_EX), -1);
 			sysassert(pwrite(sessionFile.fh, range.first, static_cast<size_t>(range.second - range.first), 0), -1);
 			sysassert(ftruncate(sessionFile.fh, range.second - range.first), -1);
+			struct stat written {};
+			sysassert(fstat(sessionFile.fh, &written), -1);
 			sysassert(flock(sessionFile.fh, LOCK_UN), -1);
+			return stampOf(written);
 		}
 
+		// The cached session if it's current, otherwise whatever is in its file, which is then cached
 		SessionPtr
-		load(const std::string & sessionId)
+		find(const std::string & sessionId)
 		{
-			auto path = root / sessionId;
-			if (!std::filesystem::exists(path)) {
-				return nullptr;
+			auto cached = cache.find(sessionId);
+			if (writeBehind) {
+				if (cached) {
+					return cached->session;
+				}
+			}
+			else {
+				struct stat current {};
+				if (stat((root / sessionId).c_str(), &current) == -1) {
+					if (errno == ENOENT) {
+						cache.erase(sessionId);
+						return nullptr;
+					}
+					throw SessionError(strerror(errno));
+				}
+				if (cached && cached->stamp == stampOf(current)) {
+					return cached->session;
+				}
+			}
+			auto loaded = load(root / sessionId);
+			if (loaded.session) {
+				cache.insert(loaded.session, loaded.stamp, false);
 			}
+			return loaded.session;
+		}
+
+		SessionCache::Cached
+		load(const std::filesystem::path & path)
+		{
 			try {
 				AdHoc::FileUtils::MemMap sessionFile(path);
 				sysassert(flock(sessionFile.fh, LOCK_SH), -1);
@@ -121,17 +208,51 @@ namespace IceSpider {
 				Ice::InputStream buf(ic, std::make_pair(fbuf.begin(), fbuf.end()));
 				SessionPtr session;
 				buf.read(session);
+				struct stat status {};
+				sysassert(fstat(sessionFile.fh, &status), -1);
 				sysassert(flock(sessionFile.fh, LOCK_UN), -1);
-				return session;
+				return {.session = session, .stamp = trusted(stampOf(status))};
 			}
 			catch (const AdHoc::SystemException & e) {
 				if (e.errNo == ENOENT) {
-					return nullptr;
+					return {.session = nullptr, .stamp = std::nullopt};
 				}
 				throw;
 			}
 		}
 
+		void
+		writeBack(const std::stop_token & stop, const std::chrono::milliseconds interval)
+		{
+			std::mutex waitLock;
+			std::condition_variable_any wait;
+			std::unique_lock waitGuard {waitLock};
+			// Only woken early to stop, after which the destructor flushes
+			while (!wait.wait_for(waitGuard, stop, interval, [&stop]() {
+				return stop.stop_requested();
+			})) {
+				try {
+					flush();
+				}
+				catch (...) { // NOLINT(bugprone-empty-catch) - tried again next time
+				}
+			}
+		}
+
+		void
+		flush()
+		{
+			const std::lock_guard guard {writeLock};
+			for (const auto & [session, generation] : cache.takeDirty()) {
+				try {
+					write(session);
+					cache.written(session->id, generation);
+				}
+				catch (const std::exception &) { // NOLINT(bugprone-empty-catch) - still dirty, so tried again next time
+				}
+			}
+		}
+
 		void
 		removeExpired()
 		{
@@ -140,7 +261,7 @@ namespace IceSpider {
 			}
 			std::filesystem::directory_iterator dirIter(root);
 			while (dirIter != std::filesystem::directory_iterator()) {
-				auto session = load(dirIter->path());
+				auto session = load(dirIter->path()).session;
 				if (session && isExpired(session)) {
 					FileSessions::destroySession(session->id, Ice::Current());
 				}
@@ -155,6 +276,33 @@ namespace IceSpider {
 			return (session->lastUsed + session->duration < time(nullptr));
 		}
 
+		[[nodiscard]]
+		static FileStamp
+		stampOf(const struct stat & status)
+		{
+			const auto nanoseconds = [](const timespec & spec) {
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::seconds {spec.tv_sec} + std::chrono::nanoseconds {spec.tv_nsec})
+						.count();
+			};
+			return {.inode = status.st_ino,
+					.size = status.st_size,
+					.modified = nanoseconds(status.st_mtim),
+					.changed = nanoseconds(status.st_ctim)};
+		}
+
+		[[nodiscard]]
+		static std::optional<FileStamp>
+		trusted(const FileStamp & stamp)
+		{
+			const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::system_clock::now().time_since_epoch());
+			if (std::chrono::nanoseconds {stamp.changed} + RACY_WINDOW < now) {
+				return stamp;
+			}
+			return std::nullopt;
+		}
+
 		template<typename R, typename ER>
 		R
 		sysassert(R rtn, ER ertn)
@@ -168,6 +316,12 @@ namespace IceSpider {
 		Ice::CommunicatorPtr ic;
 		const std::filesystem::path root;
 		const Ice::Short duration;
+		const bool writeBehind;
+		SessionCache cache;
+		// Held while writing back, and while destroying a session
+		std::mutex writeLock;
+		// Only started for WriteBehind
+		std::jthread writer;
 	};
 }
 
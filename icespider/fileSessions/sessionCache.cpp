@@ -0,0 +1,111 @@
+#include "sessionCache.h"
+#include <functional>
+#include <utility>
+
+namespace IceSpider {
+	SessionCache::SessionCache(const std::size_t capacity) : shardCapacity((capacity + SHARDS - 1) / SHARDS) { }
+
+	std::optional<SessionCache::Cached>
+	SessionCache::find(const std::string & id)
+	{
+		auto & shard = shardFor(id);
+		const std::lock_guard guard {shard.lock};
+		const auto entry = shard.index.find(id);
+		if (entry == shard.index.end()) {
+			return std::nullopt;
+		}
+		shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+		return Cached {.session = entry->second->session->ice_clone(), .stamp = entry->second->stamp};
+	}
+
+	void
+	SessionCache::insert(const SessionPtr & session, std::optional<FileStamp> stamp, bool dirty)
+	{
+		auto copy = session->ice_clone();
+		auto & shard = shardFor(copy->id);
+		const std::lock_guard guard {shard.lock};
+		uint64_t generation = 0;
+		if (const auto existing = shard.index.find(copy->id); existing != shard.index.end()) {
+			// Still dirty if an earlier change hasn't been written yet
+			const auto entry = existing->second;
+			generation = entry->generation + (dirty ? 1 : 0);
+			dirty = dirty || entry->dirty;
+			shard.index.erase(existing);
+			shard.entries.erase(entry);
+		}
+		shard.entries.push_front(
+				{.session = std::move(copy), .stamp = stamp, .dirty = dirty, .generation = generation});
+		// Views the id of the cache's own copy, which is never changed
+		shard.index.emplace(shard.entries.front().session->id, shard.entries.begin());
+		shard.trim(shardCapacity);
+	}
+
+	void
+	SessionCache::erase(const std::string & id)
+	{
+		auto & shard = shardFor(id);
+		const std::lock_guard guard {shard.lock};
+		if (const auto existing = shard.index.find(id); existing != shard.index.end()) {
+			const auto entry = existing->second;
+			shard.index.erase(existing);
+			shard.entries.erase(entry);
+		}
+	}
+
+	std::vector<SessionCache::Taken>
+	SessionCache::takeDirty()
+	{
+		std::vector<Taken> dirty;
+		for (auto & shard : shards) {
+			const std::lock_guard guard {shard.lock};
+			for (const auto & entry : shard.entries) {
+				if (entry.dirty) {
+					dirty.push_back({.session = entry.session->ice_clone(), .generation = entry.generation});
+				}
+			}
+		}
+		return dirty;
+	}
+
+	void
+	SessionCache::written(const std::string & id, const uint64_t generation)
+	{
+		auto & shard = shardFor(id);
+		const std::lock_guard guard {shard.lock};
+		if (const auto existing = shard.index.find(id);
+				existing != shard.index.end() && existing->second->generation == generation) {
+			existing->second->dirty = false;
+			shard.trim(shardCapacity);
+		}
+	}
+
+	std::size_t
+	SessionCache::size() const
+	{
+		std::size_t size = 0;
+		for (const auto & shard : shards) {
+			const std::lock_guard guard {shard.lock};
+			size += shard.entries.size();
+		}
+		return size;
+	}
+
+	SessionCache::Shard &
+	SessionCache::shardFor(const std::string & id)
+	{
+		return shards[std::hash<std::string> {}(id) % SHARDS];
+	}
+
+	void
+	SessionCache::Shard::trim(const std::size_t capacity)
+	{
+		// Least recently used first, passing over any still to be written
+		for (auto entry = entries.end(); entries.size() > capacity && entry != entries.begin();) {
+			--entry;
+			if (!entry->dirty) {
+				index.erase(entry->session->id);
+				entry = entries.erase(entry);
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <session.h>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+#include <visibility.h>
+
+namespace IceSpider {
+	// Identifies what was in a session file when it was read or written
+	struct FileStamp {
+		ino_t inode;
+		off_t size;
+		int64_t modified;
+		int64_t changed;
+
+		bool operator==(const FileStamp &) const = default;
+	};
+
+	// Thread safe, sharded LRU of decoded sessions. It hands out and keeps its own copies, so nothing a caller does to
+	// a session changes what's cached until it's inserted again. Sessions changed but not yet written (dirty) are
+	// never evicted, so a cache can briefly exceed its capacity while they wait to be written.
+	class DLL_PUBLIC SessionCache {
+	public:
+		struct Cached {
+			SessionPtr session;
+			// The file the session was read from or written to, if it's known to identify it
+			std::optional<FileStamp> stamp;
+		};
+
+		// A copy of a dirty session, to be written, and which change it includes
+		struct Taken {
+			SessionPtr session;
+			uint64_t generation;
+		};
+
+		explicit SessionCache(std::size_t capacity);
+
+		[[nodiscard]] std::optional<Cached> find(const std::string & id);
+		void insert(const SessionPtr &, std::optional<FileStamp>, bool dirty);
+		void erase(const std::string & id);
+		// Copies of the dirty sessions, which stay dirty, and so can't be evicted, until they're written
+		[[nodiscard]] std::vector<Taken> takeDirty();
+		// A taken session was written; it's clean unless it has changed again since it was taken. If the write
+		// failed, there's nothing to do: it's still dirty, and will be taken again.
+		void written(const std::string & id, uint64_t generation);
+
+		[[nodiscard]] std::size_t size() const;
+
+		// Each id belongs to one of these, holding its share of the capacity with its own lock and LRU order
+		static constexpr std::size_t SHARDS = 16;
+
+	private:
+
+		struct Entry {
+			SessionPtr session;
+			std::optional<FileStamp> stamp;
+			bool dirty;
+			// Incremented by each change, so a write of an earlier one doesn't make it clean
+			uint64_t generation;
+		};
+
+		struct Shard {
+			void trim(std::size_t capacity);
+
+			mutable std::mutex lock;
+			// Most recently used first
+			std::list<Entry> entries;
+			std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+		};
+
+		Shard & shardFor(const std::string & id);
+
+		const std::size_t shardCapacity;
+		std::array<Shard, SHARDS> shards;
+	};
+}
@@ -8,6 +8,8 @@
 #include <Ice/Optional.h>
 #include <Ice/Properties.h>
 #include <Ice/PropertiesF.h>
+#include <array>
+#include <atomic>
 #include <boost/algorithm/string/predicate.hpp>
 #include <core.h>
 #include <definedDirs.h>
@@ -15,9 +17,11 @@
 #include <exceptions.h>
 #include <factory.impl.h>
 #include <filesystem>
+#include <future>
 #include <http.h>
 #include <ihttpRequest.h>
 #include <irouteHandler.h>
+#include <iterator>
 #include <json/serializer.h>
 #include <libxml++/document.h>
 #include <libxml++/nodes/element.h>
@@ -32,6 +36,10 @@
 #include <string_view>
 #include <test-api.h>
 #include <testRequest.h>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace Ice {
 	struct Current;
@@ -86,6 +94,20 @@ BOOST_AUTO_TEST_CASE(properties)
 
 BOOST_AUTO_TEST_SUITE_END();
 
+namespace {
+	// Leaves findRequestMethod to IHttpRequest, which must catch what this throws
+	class UnsupportedMethodRequest : public TestRequest {
+	public:
+		using TestRequest::TestRequest;
+
+		HttpMethod
+		getRequestMethod() const override
+		{
+			throw Http405MethodNotAllowed();
+		}
+	};
+}
+
 BOOST_FIXTURE_TEST_SUITE(defaultProps, CoreWithDefaultRouter);
 
 BOOST_AUTO_TEST_CASE(testCoreSettings)
@@ -141,8 +163,213 @@ BOOST_AUTO_TEST_CASE(testFindRoutes)
 	BOOST_REQUIRE(findRoute(&requestMashC));
 }
 
+BOOST_AUTO_TEST_CASE(testRejectMethodDefault)
+{
+	UnsupportedMethodRequest request(this, HttpMethod::GET, "/");
+	BOOST_CHECK(!request.findRequestMethod());
+	BOOST_CHECK_NO_THROW(process(&request));
+	BOOST_CHECK_EQUAL(request.getResponseHeaders().at("Status"), "405 Method Not Allowed");
+
+	UnsupportedMethodRequest asyncRequest(this, HttpMethod::GET, "/");
+	bool done = false;
+	BOOST_CHECK_NO_THROW(processAsync(&asyncRequest, [&done]() {
+		done = true;
+	}));
+	BOOST_CHECK(done);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+BOOST_FIXTURE_TEST_SUITE(trieRouter, CoreWithTrieRouter);
+
+BOOST_AUTO_TEST_CASE(testTrieSettings)
+{
+	const auto & nodes = routes.getNodes();
+	BOOST_REQUIRE_EQUAL(21, nodes.size());
+	BOOST_REQUIRE_EQUAL(8, nodes.front().literals.size());
+	BOOST_REQUIRE(nodes.front().parameter);
+	BOOST_REQUIRE_EQUAL(1, nodes.front().routes.size());
+	BOOST_REQUIRE_EQUAL(2, nodes[*nodes.front().parameter].routes.size());
+}
+
+BOOST_AUTO_TEST_CASE(testFindRoutes)
+{
+	TestRequest requestGetIndex(this, HttpMethod::GET, "/");
+	BOOST_REQUIRE(findRoute(&requestGetIndex));
+
+	TestRequest requestPostIndex(this, HttpMethod::POST, "/");
+	BOOST_REQUIRE_THROW(findRoute(&requestPostIndex), IceSpider::Http405MethodNotAllowed);
+
+	TestRequest requestPostUpdate(this, HttpMethod::POST, "/something");
+	BOOST_REQUIRE(findRoute(&requestPostUpdate));
+
+	TestRequest requestGetUpdate(this, HttpMethod::GET, "/something");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetUpdate), IceSpider::Http405MethodNotAllowed);
+
+	TestRequest requestGetItem(this, HttpMethod::GET, "/view/something/something");
+	BOOST_REQUIRE(findRoute(&requestGetItem));
+
+	TestRequest requestGetItemParam(this, HttpMethod::GET, "/item/something/1234");
+	BOOST_REQUIRE(findRoute(&requestGetItemParam));
+
+	TestRequest requestGetItemDefault(this, HttpMethod::GET, "/item/something");
+	BOOST_REQUIRE(findRoute(&requestGetItemDefault));
+
+	TestRequest requestGetItemLong(
+			this, HttpMethod::GET, "/view/something/something/extra/many/things/longer/than/longest/route");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetItemLong), IceSpider::Http404NotFound);
+
+	TestRequest requestGetItemShort(this, HttpMethod::GET, "/view/missingSomething");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetItemShort), IceSpider::Http404NotFound);
+
+	TestRequest requestGetNothing(this, HttpMethod::GET, "/badview/something/something");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetNothing), IceSpider::Http404NotFound);
+
+	TestRequest requestDeleteThing(this, HttpMethod::DELETE, "/something");
+	BOOST_REQUIRE(findRoute(&requestDeleteThing));
+
+	TestRequest requestMashS(this, HttpMethod::GET, "/mashS/mash/1/3");
+	BOOST_REQUIRE(findRoute(&requestMashS));
+
+	TestRequest requestMashC(this, HttpMethod::GET, "/mashC/mash/1/3");
+	BOOST_REQUIRE(findRoute(&requestMashC));
+}
+
+BOOST_AUTO_TEST_CASE(testFindRoutesBacktrack)
+{
+	TestRequest requestGetSimple(this, HttpMethod::GET, "/simple");
+	const auto simple = findRoute(&requestGetSimple);
+	BOOST_REQUIRE(simple);
+	BOOST_CHECK_EQUAL(simple->path, "/simple");
+
+	TestRequest requestDeleteSimple(this, HttpMethod::DELETE, "/simple");
+	const auto del = findRoute(&requestDeleteSimple);
+	BOOST_REQUIRE(del);
+	BOOST_CHECK_EQUAL(del->path, "/{s}");
+
+	TestRequest requestPutSimple(this, HttpMethod::PUT, "/simple");
+	BOOST_REQUIRE_THROW(findRoute(&requestPutSimple), IceSpider::Http405MethodNotAllowed);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+BOOST_FIXTURE_TEST_SUITE(generatedRouter, CoreWithGeneratedRouter);
+
+BOOST_AUTO_TEST_CASE(testGeneratedSettings)
+{
+	BOOST_REQUIRE_EQUAL(1, routers.size());
+}
+
+BOOST_AUTO_TEST_CASE(testFindRoutes)
+{
+	TestRequest requestGetIndex(this, HttpMethod::GET, "/");
+	BOOST_REQUIRE(findRoute(&requestGetIndex));
+
+	TestRequest requestPostIndex(this, HttpMethod::POST, "/");
+	BOOST_REQUIRE_THROW(findRoute(&requestPostIndex), IceSpider::Http405MethodNotAllowed);
+
+	TestRequest requestPostUpdate(this, HttpMethod::POST, "/something");
+	BOOST_REQUIRE(findRoute(&requestPostUpdate));
+
+	TestRequest requestGetUpdate(this, HttpMethod::GET, "/something");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetUpdate), IceSpider::Http405MethodNotAllowed);
+
+	TestRequest requestGetItem(this, HttpMethod::GET, "/view/something/something");
+	BOOST_REQUIRE(findRoute(&requestGetItem));
+
+	TestRequest requestGetItemParam(this, HttpMethod::GET, "/item/something/1234");
+	BOOST_REQUIRE(findRoute(&requestGetItemParam));
+
+	TestRequest requestGetItemDefault(this, HttpMethod::GET, "/item/something");
+	BOOST_REQUIRE(findRoute(&requestGetItemDefault));
+
+	TestRequest requestGetItemLong(
+			this, HttpMethod::GET, "/view/something/something/extra/many/things/longer/than/longest/route");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetItemLong), IceSpider::Http404NotFound);
+
+	TestRequest requestGetItemShort(this, HttpMethod::GET, "/view/missingSomething");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetItemShort), IceSpider::Http404NotFound);
+
+	TestRequest requestGetNothing(this, HttpMethod::GET, "/badview/something/something");
+	BOOST_REQUIRE_THROW(findRoute(&requestGetNothing), IceSpider::Http404NotFound);
+
+	TestRequest requestDeleteThing(this, HttpMethod::DELETE, "/something");
+	BOOST_REQUIRE(findRoute(&requestDeleteThing));
+
+	TestRequest requestMashS(this, HttpMethod::GET, "/mashS/mash/1/3");
+	BOOST_REQUIRE(findRoute(&requestMashS));
+
+	TestRequest requestMashC(this, HttpMethod::GET, "/mashC/mash/1/3");
+	BOOST_REQUIRE(findRoute(&requestMashC));
+}
+
+BOOST_AUTO_TEST_CASE(testFindRoutesBacktrack)
+{
+	TestRequest requestGetSimple(this, HttpMethod::GET, "/simple");
+	const auto simple = findRoute(&requestGetSimple);
+	BOOST_REQUIRE(simple);
+	BOOST_CHECK_EQUAL(simple->path, "/simple");
+
+	TestRequest requestDeleteSimple(this, HttpMethod::DELETE, "/simple");
+	const auto del = findRoute(&requestDeleteSimple);
+	BOOST_REQUIRE(del);
+	BOOST_CHECK_EQUAL(del->path, "/{s}");
+
+	TestRequest requestPutSimple(this, HttpMethod::PUT, "/simple");
+	BOOST_REQUIRE_THROW(findRoute(&requestPutSimple), IceSpider::Http405MethodNotAllowed);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
+namespace {
+	// Requests covering each kind of match and refusal
+	constexpr std::array<std::pair<HttpMethod, std::string_view>, 16> ROUTER_REQUESTS {{
+			{HttpMethod::GET, "/"},
+			{HttpMethod::POST, "/"},
+			{HttpMethod::POST, "/something"},
+			{HttpMethod::GET, "/something"},
+			{HttpMethod::DELETE, "/something"},
+			{HttpMethod::GET, "/view/something/something"},
+			{HttpMethod::GET, "/item/something/1234"},
+			{HttpMethod::GET, "/item/something"},
+			{HttpMethod::GET, "/view/something/something/extra/many/things/longer/than/longest/route"},
+			{HttpMethod::GET, "/view/missingSomething"},
+			{HttpMethod::GET, "/badview/something/something"},
+			{HttpMethod::GET, "/mashS/mash/1/3"},
+			{HttpMethod::GET, "/mashC/mash/1/3"},
+			{HttpMethod::GET, "/simple"},
+			{HttpMethod::DELETE, "/simple"},
+			{HttpMethod::PUT, "/simple"},
+	}};
+
+	// What a router makes of a request: the path of the route it finds, or the status it refuses it with
+	std::string
+	routeFor(const Core & core, const HttpMethod method, const std::string_view path)
+	{
+		TestRequest request(&core, method, path);
+		try {
+			const auto * const route = core.findRoute(&request);
+			return route ? std::string {route->path} : std::string {};
+		}
+		catch (const HttpException & ex) {
+			return std::to_string(ex.code);
+		}
+	}
+}
+
+// Every other router must route each request just as the default router does
+using Routers = std::tuple<CoreWithTrieRouter, CoreWithGeneratedRouter>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(testFindRoutesAsDefault, Router, Routers)
+{
+	const CoreWithDefaultRouter reference;
+	const Router core;
+	for (const auto & [method, path] : ROUTER_REQUESTS) {
+		BOOST_TEST_INFO(path);
+		BOOST_CHECK_EQUAL(routeFor(core, method, path), routeFor(reference, method, path));
+	}
+}
+
 class TestSerice : public TestIceSpider::TestApi {
 public:
 	TestIceSpider::SomeModelPtr
@@ -240,6 +467,84 @@ BOOST_AUTO_TEST_CASE(testCallIndex)
 	BOOST_REQUIRE_EQUAL(v->value, "index");
 }
 
+BOOST_AUTO_TEST_CASE(testCallIndexAsync)
+{
+	TestRequest requestGetIndex(this, HttpMethod::GET, "/");
+	std::promise<void> done;
+	processAsync(&requestGetIndex, [&done]() {
+		done.set_value();
+	});
+	done.get_future().get();
+	auto h = requestGetIndex.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+	BOOST_REQUIRE_EQUAL(h["Content-Type"], "application/json");
+	auto v = Slicer::DeserializeAny<Slicer::JsonStreamDeserializer, TestIceSpider::SomeModelPtr>(
+			requestGetIndex.output);
+	BOOST_REQUIRE_EQUAL(v->value, "index");
+}
+
+BOOST_AUTO_TEST_CASE(testCallDeleteSomeValueAsync)
+{
+	TestRequest requestDeleteItem(this, HttpMethod::DELETE, "/some value");
+	std::promise<void> done;
+	processAsync(&requestDeleteItem, [&done]() {
+		done.set_value();
+	});
+	done.get_future().get();
+	auto h = requestDeleteItem.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+	requestDeleteItem.output.get();
+	BOOST_REQUIRE(requestDeleteItem.output.eof());
+}
+
+BOOST_AUTO_TEST_CASE(testCallMashSAsync)
+{
+	// Mashups complete synchronously through the default executeAsync
+	TestRequest requestGetMashS(this, HttpMethod::GET, "/mashS/something/something/1234");
+	bool done = false;
+	processAsync(&requestGetMashS, [&done]() {
+		done = true;
+	});
+	BOOST_REQUIRE(done);
+	auto h = requestGetMashS.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+}
+
+BOOST_AUTO_TEST_CASE(testCall404Async)
+{
+	TestRequest requestGetIndex(this, HttpMethod::GET, "/this/404");
+	bool done = false;
+	processAsync(&requestGetIndex, [&done]() {
+		done = true;
+	});
+	BOOST_REQUIRE(done);
+	auto h = requestGetIndex.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "404 Not found");
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentProcess)
+{
+	constexpr auto THREADS = 8U;
+	constexpr auto REQUESTS = 20U;
+	std::atomic<unsigned int> succeeded {};
+	{
+		std::vector<std::jthread> threads;
+		for (auto thread = 0U; thread < THREADS; ++thread) {
+			threads.emplace_back([this, &succeeded]() {
+				for (auto req = 0U; req < REQUESTS; ++req) {
+					TestRequest requestGetIndex(this, HttpMethod::GET, "/");
+					requestGetIndex.hdr["Accept"] = (req % 2) ? "text/html" : "application/json";
+					process(&requestGetIndex);
+					if (requestGetIndex.getResponseHeaders().at("Status") == "200 OK") {
+						++succeeded;
+					}
+				}
+			});
+		}
+	}
+	BOOST_CHECK_EQUAL(THREADS * REQUESTS, succeeded);
+}
+
 BOOST_AUTO_TEST_CASE(testCallMashS)
 {
 	TestRequest requestGetMashS(this, HttpMethod::GET, "/mashS/something/something/1234");
@@ -321,6 +626,31 @@ BOOST_AUTO_TEST_CASE(testCallPost1234)
 	BOOST_REQUIRE(requestUpdateItem.output.eof());
 }
 
+BOOST_AUTO_TEST_CASE(testCallPost1234ContentLength)
+{
+	TestRequest requestUpdateItem(this, HttpMethod::POST, "/1234");
+	requestUpdateItem.env["CONTENT_TYPE"] = "application/json";
+	requestUpdateItem.env["CONTENT_LENGTH"] = "23";
+	// Anything beyond the given length isn't part of the body
+	requestUpdateItem.input << R"({"value": "some value"}trailing junk)";
+	process(&requestUpdateItem);
+	auto h = requestUpdateItem.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+	requestUpdateItem.output.get();
+	BOOST_REQUIRE(requestUpdateItem.output.eof());
+}
+
+BOOST_AUTO_TEST_CASE(testCallPost1234ContentLengthTruncated)
+{
+	TestRequest requestUpdateItem(this, HttpMethod::POST, "/1234");
+	requestUpdateItem.env["CONTENT_TYPE"] = "application/json";
+	requestUpdateItem.env["CONTENT_LENGTH"] = "100";
+	requestUpdateItem.input << R"({"value": "some value"})";
+	process(&requestUpdateItem);
+	auto h = requestUpdateItem.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+}
+
 BOOST_AUTO_TEST_CASE(testCallPost1234NoContentType)
 {
 	TestRequest requestUpdateItem(this, HttpMethod::POST, "/1234");
@@ -416,11 +746,33 @@ BOOST_AUTO_TEST_CASE(testCallIndexAcceptTextHtml)
 	auto h = requestHtml.getResponseHeaders();
 	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
 	BOOST_REQUIRE_EQUAL(h["Content-Type"], "text/html");
+	BOOST_TEST_INFO(requestHtml.output.view());
+	BOOST_REQUIRE_NE(requestHtml.output.view().find("<b>value</b>: index"), std::string_view::npos);
 	xmlpp::DomParser d;
 	d.parse_stream(requestHtml.output);
 	BOOST_REQUIRE_EQUAL(d.get_document()->get_root_node()->get_name(), "html");
 }
 
+BOOST_AUTO_TEST_CASE(testCallIndexAcceptTextHtmlCached)
+{
+	// The route caches its HTML, so this is served the output rendered for the first
+	std::string first;
+	for (auto pass = 0; pass < 2; ++pass) {
+		TestRequest requestHtml(this, HttpMethod::GET, "/");
+		requestHtml.hdr["Accept"] = "text/html";
+		process(&requestHtml);
+		auto h = requestHtml.getResponseHeaders();
+		BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+		BOOST_REQUIRE_EQUAL(h["Content-Type"], "text/html");
+		std::string body {std::istreambuf_iterator<char> {requestHtml.output}, {}};
+		BOOST_REQUIRE_NE(body.find("<b>value</b>: index"), std::string::npos);
+		if (pass > 0) {
+			BOOST_CHECK_EQUAL(body, first);
+		}
+		first = std::move(body);
+	}
+}
+
 BOOST_AUTO_TEST_CASE(testCallViewSomethingAcceptHtml)
 {
 	TestRequest requestHtml(this, HttpMethod::GET, "/view/something/1234");
@@ -443,6 +795,40 @@ BOOST_AUTO_TEST_CASE(testCallIndexAcceptNotSupported)
 	BOOST_REQUIRE(requestBadAccept.output.eof());
 }
 
+BOOST_AUTO_TEST_CASE(testCallOverrideDefaultContentType)
+{
+	TestRequest requestOverride(this, HttpMethod::GET, "/override");
+	process(&requestOverride);
+	auto h = requestOverride.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+	BOOST_REQUIRE_EQUAL(h["Content-Type"], "application/xml");
+}
+
+BOOST_AUTO_TEST_CASE(testCallIndexAcceptCached)
+{
+	for (auto request = 0; request < 3; request++) {
+		TestRequest requestXml(this, HttpMethod::GET, "/");
+		requestXml.hdr["Accept"] = "application/xml";
+		process(&requestXml);
+		auto h = requestXml.getResponseHeaders();
+		BOOST_REQUIRE_EQUAL(h["Status"], "200 OK");
+		BOOST_REQUIRE_EQUAL(h["Content-Type"], "application/xml");
+	}
+	BOOST_CHECK_EQUAL(negotiationCache.getMisses(), 1);
+	BOOST_CHECK_EQUAL(negotiationCache.getHits(), 2);
+
+	for (auto request = 0; request < 2; request++) {
+		TestRequest requestBadAccept(this, HttpMethod::GET, "/");
+		requestBadAccept.hdr["Accept"] = "not/supported";
+		process(&requestBadAccept);
+		auto h = requestBadAccept.getResponseHeaders();
+		BOOST_REQUIRE_EQUAL(h["Status"], "406 Not Acceptable");
+	}
+	BOOST_CHECK_EQUAL(negotiationCache.getMisses(), 2);
+	BOOST_CHECK_EQUAL(negotiationCache.getHits(), 3);
+	BOOST_CHECK_EQUAL(negotiationCache.size(), 2);
+}
+
 BOOST_AUTO_TEST_CASE(testCallIndexComplexAccept)
 {
 	TestRequest requestChoice(this, HttpMethod::GET, "/");
@@ -569,6 +955,21 @@ BOOST_AUTO_TEST_CASE(testErrorHandler_Unhandled)
 	BOOST_REQUIRE_EQUAL(b, "Exception type: TestIceSpider::Ex\nDetail: test error\n");
 }
 
+BOOST_AUTO_TEST_CASE(testErrorHandler_UnhandledAsync)
+{
+	TestRequest requestDeleteItem(this, HttpMethod::DELETE, "/error");
+	std::promise<void> done;
+	processAsync(&requestDeleteItem, [&done]() {
+		done.set_value();
+	});
+	done.get_future().get();
+	auto h = requestDeleteItem.getResponseHeaders();
+	BOOST_REQUIRE_EQUAL(h["Status"], "500 TestIceSpider::Ex");
+	auto & o = requestDeleteItem.output;
+	auto b = o.str().substr(static_cast<std::string::size_type>(o.tellg()));
+	BOOST_REQUIRE_EQUAL(b, "Exception type: TestIceSpider::Ex\nDetail: test error\n");
+}
+
 BOOST_AUTO_TEST_CASE(testErrorHandler_Handled1)
 {
 	TestRequest requestDeleteItem(this, HttpMethod::DELETE, "/404");
@@ -6,8 +6,10 @@
 #include <Slice/Parser.h>
 #include <definedDirs.h>
 #include <filesystem>
+#include <fstream>
 #include <http.h>
 #include <iosfwd>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <routeCompiler.h>
@@ -80,8 +82,13 @@ BOOST_AUTO_TEST_CASE(testLoadConfiguration)
 	BOOST_REQUIRE_EQUAL(HttpMethod::GET, cfg->routes["mashClass"]->method);
 	BOOST_REQUIRE_EQUAL(3, cfg->routes["mashClass"]->params.size());
 
+	BOOST_REQUIRE(!cfg->routes["index"]->defaultContentType);
+	BOOST_REQUIRE(cfg->routes["override"]->defaultContentType);
+	BOOST_REQUIRE_EQUAL("application/xml", *cfg->routes["override"]->defaultContentType);
+
 	BOOST_REQUIRE_EQUAL(1, cfg->slices.size());
 	BOOST_REQUIRE_EQUAL("test-api.ice", cfg->slices[0]);
+	BOOST_REQUIRE(cfg->typedJsonWriters);
 
 	for (auto & u : units) {
 		u.second->destroy();
@@ -96,6 +103,13 @@ BOOST_AUTO_TEST_CASE(testRouteCompile)
 	Compile::RouteCompiler rc;
 	rc.searchPath.push_back(rootDir);
 	rc.compile(input, outputc);
+
+	std::ifstream generated {outputc};
+	const std::string source {std::istreambuf_iterator<char> {generated}, {}};
+	// Single operation routes have typed writers, mashups go through slicer
+	BOOST_CHECK(source.contains("request->response(this, _responseModel, &_jw_TestIceSpider_SomeModel);"));
+	BOOST_CHECK(source.contains("request->response(this, _responseModel, &_jw_int);"));
+	BOOST_CHECK(source.contains("request->response(this, _responseModel);"));
 }
 
 BOOST_AUTO_TEST_SUITE_END();
@@ -2,23 +2,33 @@
 #include <boost/test/unit_test.hpp>
 
 #include <Ice/Config.h>
+#include <arpa/inet.h>
+#include <array>
 #include <boost/lexical_cast.hpp>
 #include <cgiRequestBase.h>
 #include <core.h>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <exceptions.h>
+#include <fcgiNativeServer.h>
 #include <http.h>
 #include <ihttpRequest.h>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <netinet/in.h>
 #include <optional>
 #include <slicer/modelPartsTypes.h>
 #include <string>
 #include <string_view>
+#include <sys/socket.h>
 #include <test-fcgi.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
 namespace IceSpider {
@@ -29,6 +39,14 @@ namespace IceSpider {
 	class Http405MethodNotAllowed;
 }
 
+namespace IceSpider {
+	class Http413PayloadTooLarge;
+}
+
+namespace IceSpider {
+	class Http415UnsupportedMediaType;
+}
+
 using namespace std::literals;
 
 namespace std {
@@ -89,6 +107,16 @@ private:
 	std::istream & in;
 };
 
+// A core which takes request bodies of no more than 8 bytes, or 1000 for multipart/form-data
+class SmallBodyCore : public IceSpider::CoreWithDefaultRouter {
+public:
+	SmallBodyCore()
+	{
+		maxBodySize = 8;
+		maxMultipartBodySize = 1000;
+	}
+};
+
 namespace std {
 	// LCOV_EXCL_START assert failure helper only
 	static std::ostream &
@@ -130,6 +158,25 @@ BOOST_AUTO_TEST_CASE(redirect_uri_root)
 	BOOST_REQUIRE(r.getRequestPath().empty());
 }
 
+BOOST_AUTO_TEST_CASE(redirect_uri_preferred)
+{
+	TestRequest r(this, {{"SCRIPT_NAME=/script", "REDIRECT_URL=/foo/bar"}});
+	BOOST_REQUIRE_EQUAL(IceSpider::PathElements({"foo", "bar"}), r.getRequestPath());
+}
+
+BOOST_AUTO_TEST_CASE(env_well_known)
+{
+	TestRequest r(this, {{"SCRIPT_NAME=/", "CONTENT_TYPE=text/plain", "HTTPSX=on", "REMOTE_PORT=1234"}});
+	BOOST_CHECK(!r.isSecure());
+	BOOST_CHECK_EQUAL("/", *r.getEnvStr("SCRIPT_NAME"));
+	BOOST_CHECK_EQUAL("text/plain", *r.getEnvStr("CONTENT_TYPE"));
+	BOOST_CHECK_EQUAL("text/plain", *r.getContentType());
+	BOOST_CHECK_EQUAL("on", *r.getEnvStr("HTTPSX"));
+	BOOST_CHECK_EQUAL("1234", *r.getEnvStr("REMOTE_PORT"));
+	BOOST_CHECK(!r.getEnvStr("HTTPS"));
+	BOOST_CHECK(!r.getEnvStr("QUERY_STRING"));
+}
+
 BOOST_AUTO_TEST_CASE(script_name_foobar)
 {
 	TestRequest r(this, {{"SCRIPT_NAME=/foo/bar"}});
@@ -216,6 +263,34 @@ BOOST_AUTO_TEST_CASE(requestmethod_missing)
 	BOOST_REQUIRE_THROW((void)r.getRequestMethod(), IceSpider::Http400BadRequest);
 }
 
+BOOST_AUTO_TEST_CASE(requestmethod_bad_find)
+{
+	TestRequest r(this, {{"SCRIPT_NAME=/", "REQUEST_METHOD=No"}});
+	BOOST_CHECK(!r.findRequestMethod());
+	BOOST_CHECK(r.hasRequestMethod());
+}
+
+BOOST_AUTO_TEST_CASE(requestmethod_missing_find)
+{
+	TestRequest r {this, {{"SCRIPT_NAME=/"}}};
+	BOOST_CHECK(!r.findRequestMethod());
+	BOOST_CHECK(!r.hasRequestMethod());
+}
+
+BOOST_AUTO_TEST_CASE(requestmethod_bad_process)
+{
+	TestRequest r(this, {{"SCRIPT_NAME=/", "REQUEST_METHOD=No"}});
+	process(&r);
+	BOOST_REQUIRE_EQUAL("Status: 405 Method Not Allowed\r\n\r\n", r.out.str());
+}
+
+BOOST_AUTO_TEST_CASE(requestmethod_missing_process)
+{
+	TestRequest r {this, {{"SCRIPT_NAME=/"}}};
+	process(&r);
+	BOOST_REQUIRE_EQUAL("Status: 400 Bad Request\r\n\r\n", r.out.str());
+}
+
 BOOST_AUTO_TEST_CASE(acceptheader)
 {
 	TestRequest r(this, {{"SCRIPT_NAME=/", "HTTP_ACCEPT=text/html"}});
@@ -280,6 +355,256 @@ BOOST_AUTO_TEST_CASE(postxwwwformurlencoded_complex)
 	BOOST_REQUIRE_EQUAL("", n->empty);
 }
 
+BOOST_AUTO_TEST_CASE(postxwwwformurlencoded_complex_repeated)
+{
+	std::stringstream f("alpha=first&unknown=ignored&number=3.14&boolean=true&empty=&spaces=x&alpha=last");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=application/x-www-form-urlencoded",
+			}},
+			f);
+	auto n = *r.getBody<TestFcgi::ComplexPtr>();
+	BOOST_REQUIRE_EQUAL("last", n->alpha);
+	BOOST_REQUIRE_EQUAL(3.14, n->number);
+	BOOST_REQUIRE_EQUAL("x", n->spaces);
+}
+
+BOOST_AUTO_TEST_CASE(postxwwwformurlencoded_across_chunks)
+{
+	// Long enough that pairs, and an escape, straddle the parser's chunks
+	const std::string padding(5000, 'x');
+	std::stringstream f("alpha=" + padding + "%20y&number=3.14&boolean=true&empty=&spaces=" + padding);
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=application/x-www-form-urlencoded",
+			}},
+			f);
+	auto n = *r.getBody<TestFcgi::ComplexPtr>();
+	BOOST_REQUIRE_EQUAL(padding + " y", n->alpha);
+	BOOST_REQUIRE_EQUAL(3.14, n->number);
+	BOOST_REQUIRE_EQUAL(padding, n->spaces);
+}
+
+BOOST_FIXTURE_TEST_CASE(postxwwwformurlencoded_declared_too_large, SmallBodyCore)
+{
+	std::stringstream f("value=314");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=application/x-www-form-urlencoded",
+					"CONTENT_LENGTH=9",
+			}},
+			f);
+	BOOST_REQUIRE_THROW((void)r.getBody<int>(), IceSpider::Http413PayloadTooLarge);
+}
+
+BOOST_FIXTURE_TEST_CASE(postxwwwformurlencoded_undeclared_too_large, SmallBodyCore)
+{
+	std::stringstream f("value=314");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=application/x-www-form-urlencoded",
+			}},
+			f);
+	BOOST_REQUIRE_THROW((void)r.getBody<int>(), IceSpider::Http413PayloadTooLarge);
+}
+
+BOOST_AUTO_TEST_CASE(postxwwwformurlencoded_with_charset)
+{
+	std::stringstream f("value=314");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=application/x-www-form-urlencoded; charset=UTF-8",
+			}},
+			f);
+	auto n = r.getBody<int>();
+	BOOST_REQUIRE_EQUAL(314, n);
+}
+
+namespace {
+	std::string
+	multipartField(const std::string_view name, const std::string_view value)
+	{
+		return "--BoUnDaRy\r\nContent-Disposition: form-data; name=\"" + std::string {name} + "\"\r\n\r\n"
+				+ std::string {value} + "\r\n";
+	}
+
+	std::string
+	multipartFile(const std::string_view name, const std::string_view value)
+	{
+		return "--BoUnDaRy\r\nContent-Disposition: form-data; name=\"" + std::string {name}
+				+ "\"; filename=\"upload.bin\"\r\nContent-Type: application/octet-stream\r\n\r\n" + std::string {value}
+				+ "\r\n";
+	}
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_complex)
+{
+	std::stringstream f(multipartField("alpha", "abcde") + multipartField("number", "3.14")
+			+ multipartField("boolean", "true") + multipartField("empty", "")
+			+ multipartField("spaces", "This is a string.") + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	auto n = *r.getBody<TestFcgi::ComplexPtr>();
+	BOOST_REQUIRE_EQUAL("abcde", n->alpha);
+	BOOST_REQUIRE_EQUAL(3.14, n->number);
+	BOOST_REQUIRE_EQUAL(true, n->boolean);
+	BOOST_REQUIRE_EQUAL("This is a string.", n->spaces);
+	BOOST_REQUIRE_EQUAL("", n->empty);
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_dictionary)
+{
+	std::stringstream f("preamble\r\n" + multipartField("alpha", "abcde") + multipartField("spaces", "line 1\r\nline 2")
+			+ "--BoUnDaRy--\r\nepilogue");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=\"BoUnDaRy\"",
+			}},
+			f);
+	auto n = *r.getBody<IceSpider::StringMap>();
+	BOOST_REQUIRE_EQUAL(2, n.size());
+	BOOST_REQUIRE_EQUAL("abcde", n["alpha"]);
+	BOOST_REQUIRE_EQUAL("line 1\r\nline 2", n["spaces"]);
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_spooled)
+{
+	// Larger than is kept in memory, and than a single read
+	std::string upload(200000, 'x');
+	upload.replace(100000, 11, "\r\n--BoUnDaR");
+	std::stringstream f(multipartField("alpha", upload) + multipartField("spaces", "small") + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	auto n = *r.getBody<TestFcgi::ComplexPtr>();
+	BOOST_REQUIRE_EQUAL(upload, n->alpha);
+	BOOST_REQUIRE_EQUAL("small", n->spaces);
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_bytes)
+{
+	const auto content = "\0\x01\xff\r\nbinary"sv;
+	std::stringstream f(multipartField("title", "small") + multipartFile("content", content) + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	auto n = *r.getBody<TestFcgi::UploadPtr>();
+	BOOST_REQUIRE_EQUAL("small", n->title);
+	BOOST_CHECK_EQUAL_COLLECTIONS(n->content.begin(), n->content.end(), content.begin(), content.end());
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_bytes_spooled)
+{
+	// Larger than is kept in memory, so read back from the spool
+	std::string upload(200000, '\0');
+	for (std::size_t i = 0; i < upload.length(); ++i) {
+		upload[i] = static_cast<char>(i % 251);
+	}
+	std::stringstream f(multipartFile("content", upload) + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	auto n = *r.getBody<TestFcgi::UploadPtr>();
+	BOOST_CHECK_EQUAL_COLLECTIONS(n->content.begin(), n->content.end(), upload.begin(), upload.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(postmultipart_own_limit, SmallBodyCore)
+{
+	std::stringstream f(multipartField("alpha", "abcde") + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	auto n = *r.getBody<IceSpider::StringMap>();
+	BOOST_REQUIRE_EQUAL("abcde", n["alpha"]);
+}
+
+BOOST_FIXTURE_TEST_CASE(postmultipart_declared_too_large, SmallBodyCore)
+{
+	std::stringstream f(multipartField("alpha", std::string(1000, 'x')) + "--BoUnDaRy--\r\n");
+	const auto length = "CONTENT_LENGTH=" + std::to_string(f.str().length());
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+					length.c_str(),
+			}},
+			f);
+	BOOST_REQUIRE_THROW((void)r.getBody<IceSpider::StringMap>(), IceSpider::Http413PayloadTooLarge);
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_binary_string)
+{
+	std::stringstream f(multipartFile("alpha", "abcde") + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	BOOST_REQUIRE_THROW((void)r.getBody<TestFcgi::ComplexPtr>(), IceSpider::Http415UnsupportedMediaType);
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_no_boundary)
+{
+	std::stringstream f(multipartField("alpha", "abcde") + "--BoUnDaRy--\r\n");
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data",
+			}},
+			f);
+	BOOST_REQUIRE_THROW((void)r.getBody<TestFcgi::ComplexPtr>(), IceSpider::Http400BadRequest);
+}
+
+BOOST_AUTO_TEST_CASE(postmultipart_truncated)
+{
+	std::stringstream f(multipartField("alpha", "abcde"));
+	TestPayloadRequest r(this,
+			{{
+					"SCRIPT_NAME=/",
+					"REQUEST_METHOD=No",
+					"CONTENT_TYPE=multipart/form-data; boundary=BoUnDaRy",
+			}},
+			f);
+	BOOST_REQUIRE_THROW((void)r.getBody<TestFcgi::ComplexPtr>(), IceSpider::Http400BadRequest);
+}
+
 BOOST_AUTO_TEST_CASE(postjson_complex)
 {
 	std::stringstream f {R"J({"alpha":"abcde","number":3.14,"boolean":true,"empty":"","spaces":"This is a string."})J"};
@@ -334,3 +659,249 @@ BOOST_AUTO_TEST_CASE(response)
 }
 
 BOOST_AUTO_TEST_SUITE_END();
+
+namespace {
+	struct FcgiRecord {
+		IceSpider::Fcgi::RecordType type;
+		uint16_t requestId;
+		std::string content;
+	};
+
+	class FcgiServerFixture : public IceSpider::CoreWithDefaultRouter {
+	public:
+		using NameValues = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+		FcgiServerFixture() : listenFd {::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)}
+		{
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t addressLength = sizeof(address);
+			// NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+			BOOST_REQUIRE_EQUAL(0, ::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)));
+			BOOST_REQUIRE_EQUAL(0, ::listen(listenFd, SOMAXCONN));
+			BOOST_REQUIRE_EQUAL(0, ::getsockname(listenFd, reinterpret_cast<sockaddr *>(&address), &addressLength));
+			// NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+			server.emplace(*this, listenFd);
+			loop = std::jthread {&IceSpider::FcgiServer::run, &*server};
+		}
+
+		~FcgiServerFixture()
+		{
+			server->stop();
+			loop.join();
+			::close(listenFd);
+		}
+
+		FcgiServerFixture(const FcgiServerFixture &) = delete;
+		FcgiServerFixture(FcgiServerFixture &&) = delete;
+		FcgiServerFixture & operator=(const FcgiServerFixture &) = delete;
+		FcgiServerFixture & operator=(FcgiServerFixture &&) = delete;
+
+		[[nodiscard]] int
+		connectClient() const
+		{
+			const auto client = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			BOOST_REQUIRE_EQUAL(0, ::connect(client, reinterpret_cast<const sockaddr *>(&address), sizeof(address)));
+			return client;
+		}
+
+		static std::string
+		request(uint16_t requestId, bool keepConnection, NameValues params, std::string_view body = {})
+		{
+			using namespace IceSpider::Fcgi;
+			std::string records, nameValues;
+			const std::array<char, HEADER_LEN> begin {
+					0, ROLE_RESPONDER, static_cast<char>(keepConnection ? FLAG_KEEP_CONN : 0)};
+			appendRecord(records, RecordType::BeginRequest, requestId, {begin.data(), begin.size()});
+			for (const auto & [name, value] : params) {
+				appendNameValue(nameValues, name, value);
+			}
+			appendRecord(records, RecordType::Params, requestId, nameValues);
+			appendRecord(records, RecordType::Params, requestId, {});
+			if (!body.empty()) {
+				appendRecord(records, RecordType::Stdin, requestId, body);
+			}
+			appendRecord(records, RecordType::Stdin, requestId, {});
+			return records;
+		}
+
+		static void
+		write(int client, std::string_view data)
+		{
+			while (!data.empty()) {
+				const auto bytes = ::send(client, data.data(), data.size(), MSG_NOSIGNAL);
+				BOOST_REQUIRE_GT(bytes, 0);
+				data.remove_prefix(static_cast<size_t>(bytes));
+			}
+		}
+
+		static bool
+		read(int client, char * buffer, size_t length)
+		{
+			while (length > 0) {
+				const auto bytes = ::recv(client, buffer, length, 0);
+				if (bytes <= 0) {
+					return false;
+				}
+				buffer += bytes;
+				length -= static_cast<size_t>(bytes);
+			}
+			return true;
+		}
+
+		static std::optional<FcgiRecord>
+		readRecord(int client)
+		{
+			std::array<unsigned char, IceSpider::Fcgi::HEADER_LEN> header {};
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			if (!read(client, reinterpret_cast<char *>(header.data()), header.size())) {
+				return std::nullopt;
+			}
+			const auto contentLength = static_cast<size_t>((header[4] << 8U) | header[5]);
+			std::string content(contentLength + header[6], '\0');
+			BOOST_REQUIRE(read(client, content.data(), content.size()));
+			content.resize(contentLength);
+			return FcgiRecord {static_cast<IceSpider::Fcgi::RecordType>(header[1]),
+					static_cast<uint16_t>((header[2] << 8U) | header[3]), std::move(content)};
+		}
+
+		// Collects stdout per request until the given number of requests have ended
+		static std::map<uint16_t, std::string>
+		readResponses(int client, size_t requests)
+		{
+			std::map<uint16_t, std::string> responses;
+			while (requests > 0) {
+				const auto record = readRecord(client);
+				BOOST_REQUIRE(record);
+				if (record->type == IceSpider::Fcgi::RecordType::Stdout) {
+					responses[record->requestId] += record->content;
+				}
+				else if (record->type == IceSpider::Fcgi::RecordType::EndRequest) {
+					BOOST_REQUIRE_EQUAL(8, record->content.size());
+					BOOST_CHECK_EQUAL(0, record->content[4]);
+					--requests;
+				}
+			}
+			return responses;
+		}
+
+	private:
+		int listenFd;
+		sockaddr_in address {};
+		std::optional<IceSpider::FcgiServer> server;
+		std::jthread loop;
+	};
+
+	class SmallBodyServer : public FcgiServerFixture {
+	public:
+		SmallBodyServer()
+		{
+			maxBodySize = 1000;
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_SUITE(NativeFcgiServer, FcgiServerFixture);
+
+BOOST_AUTO_TEST_CASE(singleRequest)
+{
+	const auto client = connectClient();
+	write(client, request(1, false, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "GET"}}));
+	auto responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 404 Not found\r\n\r\n", responses[1]);
+	// Not FCGI_KEEP_CONN, so the server closes
+	BOOST_CHECK(!readRecord(client));
+	::close(client);
+}
+
+BOOST_AUTO_TEST_CASE(multiplexedRequests)
+{
+	const auto client = connectClient();
+	const auto records = request(1, true, {{"REQUEST_METHOD", "GET"}})
+			+ request(2, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "POST"}}, std::string(100000, 'x'));
+	// Trickle the records in to exercise reassembly of partial records
+	constexpr size_t CHUNK = 7;
+	for (size_t offset = 0; offset < records.size(); offset += CHUNK) {
+		write(client, std::string_view {records}.substr(offset, CHUNK));
+	}
+	auto responses = readResponses(client, 2);
+	BOOST_CHECK_EQUAL("Status: 400 Bad Request\r\n\r\n", responses[1]);
+	BOOST_CHECK_EQUAL("Status: 404 Not found\r\n\r\n", responses[2]);
+
+	// Connection kept open for the next request
+	write(client, request(3, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "GET"}}));
+	responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 404 Not found\r\n\r\n", responses[3]);
+	::close(client);
+}
+
+BOOST_AUTO_TEST_CASE(halfClosed)
+{
+	const auto client = connectClient();
+	write(client, request(1, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "GET"}}));
+	// Nothing more to send, but the request is still answered before the server closes
+	::shutdown(client, SHUT_WR);
+	auto responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 404 Not found\r\n\r\n", responses[1]);
+	BOOST_CHECK(!readRecord(client));
+	::close(client);
+}
+
+BOOST_FIXTURE_TEST_CASE(declaredBodyTooLarge, SmallBodyServer)
+{
+	const auto client = connectClient();
+	write(client,
+			request(1, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "POST"}, {"CONTENT_LENGTH", "100000"}},
+					std::string(100000, 'x')));
+	auto responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 413 Payload Too Large\r\n\r\n", responses[1]);
+
+	// The rest of the rejected request's body is discarded and the connection still works
+	write(client, request(2, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "GET"}}));
+	responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 404 Not found\r\n\r\n", responses[2]);
+	::close(client);
+}
+
+BOOST_FIXTURE_TEST_CASE(streamedBodyTooLarge, SmallBodyServer)
+{
+	const auto client = connectClient();
+	// Kept open, so the server doesn't close while the body is still being sent
+	write(client, request(1, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "POST"}}, std::string(100000, 'x')));
+	auto responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 413 Payload Too Large\r\n\r\n", responses[1]);
+
+	write(client, request(2, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "GET"}}));
+	responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 404 Not found\r\n\r\n", responses[2]);
+	::close(client);
+}
+
+BOOST_AUTO_TEST_CASE(paramsTooLarge)
+{
+	const auto client = connectClient();
+	const std::string cookie(2000000, 'c');
+	write(client, request(1, true, {{"SCRIPT_NAME", "/"}, {"REQUEST_METHOD", "GET"}, {"HTTP_COOKIE", cookie}}));
+	auto responses = readResponses(client, 1);
+	BOOST_CHECK_EQUAL("Status: 400 Bad Request\r\n\r\n", responses[1]);
+	::close(client);
+}
+
+BOOST_AUTO_TEST_CASE(getValues)
+{
+	const auto client = connectClient();
+	std::string query, records;
+	IceSpider::Fcgi::appendNameValue(query, "FCGI_MPXS_CONNS", "");
+	IceSpider::Fcgi::appendNameValue(query, "UNKNOWN", "");
+	IceSpider::Fcgi::appendRecord(
+			records, IceSpider::Fcgi::RecordType::GetValues, IceSpider::Fcgi::NULL_REQUEST_ID, query);
+	write(client, records);
+	const auto result = readRecord(client);
+	BOOST_REQUIRE(result);
+	BOOST_CHECK(result->type == IceSpider::Fcgi::RecordType::GetValuesResult);
+	BOOST_CHECK_EQUAL("\x0f\x01"s "FCGI_MPXS_CONNS1", result->content);
+	::close(client);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
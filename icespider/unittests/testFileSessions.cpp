@@ -73,6 +73,24 @@ BOOST_AUTO_TEST_CASE(createAndChangeRestore)
 	prx->destroySession(s->id);
 }
 
+BOOST_AUTO_TEST_CASE(sharedPath)
+{
+	// Each sees the other's changes, despite having cached the session
+	TestCore other;
+	auto prx = this->getProxy<IceSpider::SessionManager>();
+	auto otherPrx = other.getProxy<IceSpider::SessionManager>();
+	auto s = prx->createSession();
+	s->variables["a"] = "first";
+	prx->updateSession(s);
+	BOOST_REQUIRE_EQUAL(otherPrx->getSession(s->id)->variables.at("a"), "first");
+	s->variables["a"] = "second";
+	prx->updateSession(s);
+	BOOST_REQUIRE_EQUAL(otherPrx->getSession(s->id)->variables.at("a"), "second");
+
+	prx->destroySession(s->id);
+	BOOST_REQUIRE(!otherPrx->getSession(s->id));
+}
+
 BOOST_AUTO_TEST_CASE(createAndExpire)
 {
 	auto prx = this->getProxy<IceSpider::SessionManager>();
@@ -112,6 +130,45 @@ BOOST_AUTO_TEST_CASE(expire)
 
 BOOST_AUTO_TEST_SUITE_END();
 
+class WriteBehindCore : public IceSpider::CoreWithDefaultRouter {
+public:
+	WriteBehindCore() :
+		IceSpider::CoreWithDefaultRouter({"--IceSpider.SessionManager=IceSpider-FileSessions",
+				"--IceSpider.FileSessions.Path=" + (binDir / "test-sessions-write-behind").string(),
+				"--IceSpider.FileSessions.Duration=60", "--IceSpider.FileSessions.Coherency=WriteBehind",
+				"--IceSpider.FileSessions.WriteInterval=60000"}),
+		root(communicator->getProperties()->getProperty("IceSpider.FileSessions.Path"))
+	{
+	}
+
+	// NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+	const std::filesystem::path root;
+};
+
+BOOST_AUTO_TEST_CASE(writeBehind)
+{
+	std::string id;
+	{
+		WriteBehindCore core;
+		auto prx = core.getProxy<IceSpider::SessionManager>();
+		auto s = prx->createSession();
+		id = s->id;
+		BOOST_REQUIRE(std::filesystem::exists(core.root / id));
+		s->variables["a"] = "value";
+		prx->updateSession(s);
+		BOOST_REQUIRE_EQUAL(prx->getSession(id)->variables, s->variables);
+	}
+	// Written when the first was shut down
+	WriteBehindCore core;
+	auto prx = core.getProxy<IceSpider::SessionManager>();
+	auto s = prx->getSession(id);
+	BOOST_REQUIRE(s);
+	BOOST_REQUIRE_EQUAL(s->variables.at("a"), "value");
+	prx->destroySession(id);
+	BOOST_REQUIRE(!std::filesystem::exists(core.root / id));
+	BOOST_REQUIRE(!prx->getSession(id));
+}
+
 BOOST_AUTO_TEST_CASE(empty)
 {
 	TestCore tc;
@@ -10,6 +10,7 @@
 using TM = IceSpider::FlatMap<std::string_view, int>;
 
 BOOST_TEST_DONT_PRINT_LOG_VALUE(TM::const_iterator)
+BOOST_TEST_DONT_PRINT_LOG_VALUE(TM::V)
 
 BOOST_FIXTURE_TEST_SUITE(sv2int, TM)
 
@@ -104,3 +105,97 @@ BOOST_AUTO_TEST_CASE(several)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE(bulk, TM)
+
+BOOST_AUTO_TEST_CASE(append_sort)
+{
+	append("f", 6);
+	append("a", 1);
+	append("c", 3);
+	sort();
+
+	BOOST_CHECK_EQUAL(size(), 3);
+	BOOST_CHECK_EQUAL(begin()->first, "a");
+	BOOST_CHECK_EQUAL(at("a"), 1);
+	BOOST_CHECK_EQUAL(at("c"), 3);
+	BOOST_CHECK_EQUAL(at("f"), 6);
+	BOOST_CHECK(!contains("b"));
+}
+
+BOOST_AUTO_TEST_CASE(sort_empty)
+{
+	sort();
+
+	BOOST_CHECK(empty());
+}
+
+BOOST_AUTO_TEST_CASE(duplicates_keep_last)
+{
+	append("b", 1);
+	append("a", 2);
+	append("b", 3);
+	append("b", 4);
+	append("a", 5);
+	sort(IceSpider::DuplicateKeys::KeepLast);
+
+	BOOST_CHECK_EQUAL(size(), 2);
+	BOOST_CHECK_EQUAL(at("a"), 5);
+	BOOST_CHECK_EQUAL(at("b"), 4);
+}
+
+BOOST_AUTO_TEST_CASE(duplicates_keep_first)
+{
+	append("b", 1);
+	append("a", 2);
+	append("b", 3);
+	append("b", 4);
+	append("a", 5);
+	sort(IceSpider::DuplicateKeys::KeepFirst);
+
+	BOOST_CHECK_EQUAL(size(), 2);
+	BOOST_CHECK_EQUAL(at("a"), 2);
+	BOOST_CHECK_EQUAL(at("b"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(duplicates_keep_all)
+{
+	append("b", 1);
+	append("a", 2);
+	append("b", 3);
+	append("b", 4);
+	append("a", 5);
+	sort();
+
+	const std::vector<std::pair<std::string_view, int>> expected {{"a", 5}, {"a", 2}, {"b", 4}, {"b", 3}, {"b", 1}};
+	BOOST_CHECK_EQUAL_COLLECTIONS(begin(), end(), expected.begin(), expected.end());
+	BOOST_CHECK_EQUAL(at("a"), 5);
+	BOOST_CHECK_EQUAL(at("b"), 4);
+}
+
+BOOST_AUTO_TEST_CASE(keep_all_matches_insert)
+{
+	TM inserted;
+	for (const auto & [key, value] : {std::pair {"x", 1}, {"y", 2}, {"x", 3}}) {
+		inserted.insert({key, value});
+		append(key, value);
+	}
+	sort();
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(begin(), end(), inserted.begin(), inserted.end());
+}
+
+BOOST_AUTO_TEST_CASE(keep_last_matches_insert)
+{
+	TM inserted;
+	for (const auto & [key, value] : {std::pair {"x", 1}, {"y", 2}, {"x", 3}}) {
+		inserted.insert({key, value});
+		append(key, value);
+	}
+	sort(IceSpider::DuplicateKeys::KeepLast);
+
+	BOOST_CHECK_EQUAL(at("x"), inserted.at("x"));
+	BOOST_CHECK_EQUAL(at("y"), inserted.at("y"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+#define BOOST_TEST_MODULE JsonSerializer
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <http.h>
+#include <json/serializer.h>
+#include <jsonStreamSerializer.h>
+#include <limits>
+#include <memory>
+#include <slicer/slicer.h>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <test-serializers.h>
+
+using namespace boost::unit_test::data;
+
+namespace {
+	std::string
+	escaped(const std::string_view value)
+	{
+		std::stringstream out;
+		IceSpider::JsonStreamSerializer::writeString(*out.rdbuf(), value);
+		return out.str();
+	}
+
+	template<typename Value>
+	std::string
+	key(const Value value)
+	{
+		std::stringstream out;
+		IceSpider::JsonStreamSerializer::writeKey(*out.rdbuf(), value);
+		return out.str();
+	}
+
+	// Ours must be a drop in replacement for slicer's own, byte for byte
+	template<typename Model>
+	void
+	checkSameAsSlicer(const Model & model)
+	{
+		std::stringstream ours, slicers;
+		Slicer::SerializeAny<IceSpider::JsonStreamSerializer>(model, ours);
+		Slicer::SerializeAny<Slicer::JsonStreamSerializer>(model, slicers);
+		BOOST_CHECK_EQUAL(ours.str(), slicers.str());
+	}
+
+	TestSerializers::EverythingPtr
+	everything()
+	{
+		auto model = std::make_shared<TestSerializers::Everything>();
+		model->flag = true;
+		model->small = std::numeric_limits<Ice::Byte>::max();
+		model->medium = std::numeric_limits<Ice::Short>::min();
+		model->large = -1;
+		model->huge = std::numeric_limits<Ice::Long>::max();
+		model->single = 1.5F;
+		model->dbl = -0.25;
+		model->text = "text with \"quotes\" and a\nline break";
+		model->colour = TestSerializers::Colour::Blue;
+		model->original = "renamed";
+		model->maybeText = "present";
+		model->maybeNumber = 0;
+		model->nested = std::make_shared<TestSerializers::Derived>(1, "derived");
+		model->bases = {std::make_shared<TestSerializers::Base>(2), nullptr,
+				std::make_shared<TestSerializers::Derived>(3, "")};
+		model->colours = {TestSerializers::Colour::Red, TestSerializers::Colour::Green};
+		model->bytes = {0, 1, std::numeric_limits<Ice::Byte>::max()};
+		model->doubles = {0, 1, -1.5, 1024.125, 3};
+		model->intNames = {{-1, "minus one"}, {1, "one"}};
+		model->namedInts = {{"", 0}, {"one", 1}, {"quote\"", 2}};
+		model->longKeyed = {{std::numeric_limits<Ice::Long>::min(), "min"}, {0, "zero"}};
+		return model;
+	}
+}
+
+BOOST_DATA_TEST_CASE(
+		plain, make({"", "plain", "a longer string which will take the vector path", "caf\xc3\xa9"}), value)
+{
+	BOOST_CHECK_EQUAL(IceSpider::JsonStreamSerializer::plainPrefix(value), std::string_view {value}.length());
+	BOOST_CHECK_EQUAL(escaped(value), '"' + std::string {value} + '"');
+}
+
+BOOST_AUTO_TEST_CASE(escapes)
+{
+	BOOST_CHECK_EQUAL(escaped("\""), R"("\"")");
+	BOOST_CHECK_EQUAL(escaped("\\"), R"("\\")");
+	BOOST_CHECK_EQUAL(escaped("a\tb\nc\rd\be\ff"), R"("a\tb\nc\rd\be\ff")");
+	BOOST_CHECK_EQUAL(escaped(std::string_view {"\0\x1f", 2}), R"("\u0000\u001f")");
+}
+
+BOOST_AUTO_TEST_CASE(escapes_at_every_offset)
+{
+	for (std::size_t offset = 0; offset < 70; ++offset) {
+		std::string value(offset, 'x');
+		value += "\"tail of some length";
+		BOOST_CHECK_EQUAL(IceSpider::JsonStreamSerializer::plainPrefix(value), offset);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+	const IceSpider::StringMap map {
+			{"key", "value"},
+			{"quoted \"key\"", "line\nbreak"},
+			{"", "\x01 control"},
+	};
+	std::stringstream out;
+	Slicer::SerializeAny<IceSpider::JsonStreamSerializer>(map, out);
+	BOOST_CHECK_EQUAL(out.str(), R"({"":"\u0001 control","key":"value","quoted \"key\"":"line\nbreak"})");
+	const auto back = Slicer::DeserializeAny<Slicer::JsonStreamDeserializer, IceSpider::StringMap>(out);
+	BOOST_CHECK(back == map);
+}
+
+BOOST_AUTO_TEST_CASE(keys)
+{
+	BOOST_CHECK_EQUAL(key(true), R"("true")");
+	BOOST_CHECK_EQUAL(key(std::string {"k"}), R"("k")");
+	BOOST_CHECK_EQUAL(key(Ice::Byte {255}), R"("255")");
+	BOOST_CHECK_EQUAL(key(Ice::Short {-3}), R"("-3")");
+	BOOST_CHECK_EQUAL(key(Ice::Int {42}), R"("42")");
+	BOOST_CHECK_EQUAL(key(std::numeric_limits<Ice::Long>::min()), R"("-9223372036854775808")");
+	// Formatted as values are, not as std::to_string would
+	BOOST_CHECK_EQUAL(key(Ice::Float {1.5F}), R"("1.5")");
+	BOOST_CHECK_EQUAL(key(Ice::Double {0.1}), R"("0.1")");
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_defaults)
+{
+	checkSameAsSlicer(std::make_shared<TestSerializers::Everything>());
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_everything)
+{
+	checkSameAsSlicer(everything());
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_null)
+{
+	checkSameAsSlicer(TestSerializers::EverythingPtr {});
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_type_id)
+{
+	checkSameAsSlicer(TestSerializers::BasePtr {std::make_shared<TestSerializers::Derived>(1, "derived")});
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_collections)
+{
+	const auto model = everything();
+	checkSameAsSlicer(model->bases);
+	checkSameAsSlicer(model->colours);
+	checkSameAsSlicer(model->bytes);
+	checkSameAsSlicer(model->doubles);
+	checkSameAsSlicer(model->intNames);
+	checkSameAsSlicer(model->namedInts);
+	checkSameAsSlicer(model->longKeyed);
+	checkSameAsSlicer(TestSerializers::Bases {});
+	checkSameAsSlicer(TestSerializers::NamedInts {});
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_simple)
+{
+	checkSameAsSlicer(std::string {"\x01 control"});
+	checkSameAsSlicer(Ice::Int {-7});
+	checkSameAsSlicer(Ice::Double {2.5});
+	checkSameAsSlicer(true);
+}
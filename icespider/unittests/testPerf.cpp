@@ -1,11 +1,89 @@
+#include <atomic>
 #include <benchmark/benchmark.h>
 #include <cgiRequestBase.h>
 #include <core.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <definedDirs.h>
+#include <flatMap.h>
 #include <fstream>
+#include <json/serializer.h>
+#include <jsonStreamSerializer.h>
+#include <libxml/xmlmemory.h>
+#include <new>
+#include <slicer/slicer.h>
+#include <sstream>
+#include <string>
+#include <stylesheetCache.h>
+#include <test-fcgi.h>
+#include <vector>
+#include <xsltStreamSerializer.h>
+#include <xwwwFormUrlEncoded.h>
 
 #define BENCHMARK_CAPTURE_LITERAL(Name, Value) BENCHMARK_CAPTURE(Name, Value, Value);
 
+namespace {
+	std::atomic<std::size_t> allocations {};
+
+	// libxml2 and libxslt allocate through these instead, once installed with xmlMemSetup
+	void *
+	xmlCountingMalloc(std::size_t size)
+	{
+		++allocations;
+		// NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+		return std::malloc(size);
+	}
+
+	void *
+	xmlCountingRealloc(void * ptr, std::size_t size)
+	{
+		++allocations;
+		// NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+		return std::realloc(ptr, size);
+	}
+
+	char *
+	xmlCountingStrdup(const char * str)
+	{
+		++allocations;
+		return strdup(str);
+	}
+
+	void
+	xmlCountingFree(void * ptr)
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+		std::free(ptr);
+	}
+}
+
+// Count heap allocations so benchmarks can report them per request
+void *
+operator new(std::size_t size)
+{
+	++allocations;
+	// NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+	if (auto * ptr = std::malloc(size)) {
+		return ptr;
+	}
+	throw std::bad_alloc {};
+}
+
+void
+operator delete(void * ptr) noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+	std::free(ptr);
+}
+
+void
+operator delete(void * ptr, std::size_t) noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+	std::free(ptr);
+}
+
 class TestRequest : public IceSpider::CgiRequestBase {
 public:
 	TestRequest(IceSpider::Core * c, const EnvArray env) : IceSpider::CgiRequestBase(c, env) { }
@@ -57,6 +135,30 @@ BENCHMARK_F(CoreFixture, script_name_root)(benchmark::State & state)
 	}
 }
 
+BENCHMARK_F(CoreFixture, script_name_root_query_string)(benchmark::State & state)
+{
+	CharPtrPtrArray env(rootDir / "fixtures/env1");
+	for (auto _ : state) {
+		TestRequest r(this, env);
+		benchmark::DoNotOptimize(r.getQueryStringParamStr("q"));
+		benchmark::DoNotOptimize(r.getCookieParamStr("s"));
+		benchmark::DoNotOptimize(r.getHeaderParamStr("Accept"));
+	}
+}
+
+BENCHMARK_F(CoreFixture, script_name_root_allocations)(benchmark::State & state)
+{
+	CharPtrPtrArray env(rootDir / "fixtures/env1");
+	std::size_t total {};
+	for (auto _ : state) {
+		const auto before = allocations.load();
+		TestRequest r(this, env);
+		benchmark::DoNotOptimize(r.getQueryStringParamStr("q"));
+		total += allocations.load() - before;
+	}
+	state.counters["allocs"] = benchmark::Counter(static_cast<double>(total), benchmark::Counter::kAvgIterations);
+}
+
 BENCHMARK_F(CoreFixture, is_secure)(benchmark::State & state)
 {
 	CharPtrPtrArray env(rootDir / "fixtures/env1");
@@ -128,6 +230,133 @@ namespace {
 			benchmark::DoNotOptimize(IceSpider::IHttpRequest::parseAccept(accept));
 		}
 	}
+
+	// Keys in a scrambled, but repeatable, order
+	std::vector<std::string>
+	flatMapKeys(const std::size_t count)
+	{
+		std::vector<std::string> keys;
+		keys.reserve(count);
+		for (std::size_t key = 0; key < count; ++key) {
+			keys.emplace_back("KEY_" + std::to_string((key * 7919) % count));
+		}
+		return keys;
+	}
+
+	void
+	FlatMapInsert(benchmark::State & state)
+	{
+		const auto keys = flatMapKeys(static_cast<std::size_t>(state.range(0)));
+		for (auto _ : state) {
+			IceSpider::FlatMap<std::string_view, std::string_view> map;
+			for (const auto & key : keys) {
+				map.insert({key, key});
+			}
+			benchmark::DoNotOptimize(map);
+		}
+	}
+
+	TestFcgi::Complexes
+	complexModel(const std::int64_t count)
+	{
+		TestFcgi::Complexes complexes;
+		for (auto element = 0; element < count; ++element) {
+			complexes.push_back(std::make_shared<TestFcgi::Complex>("some \"quoted\" text " + std::to_string(element),
+					element * 1.5, element % 2 == 0, "with\ttabs and\nnew lines", ""));
+		}
+		return complexes;
+	}
+
+	template<typename Serializer>
+	void
+	JsonSerialize(benchmark::State & state)
+	{
+		const auto complexes = complexModel(state.range(0));
+		for (auto _ : state) {
+			std::stringstream out;
+			Slicer::SerializeAny<Serializer>(complexes, out);
+			benchmark::DoNotOptimize(out);
+		}
+	}
+
+	void
+	XsltSerialize(benchmark::State & state)
+	{
+		xmlMemSetup(xmlCountingFree, xmlCountingMalloc, xmlCountingRealloc, xmlCountingStrdup);
+		// transform.xslt has no template for this, so the built-in rules visit every node, as a full page would
+		const auto complexes = complexModel(state.range(0));
+		const auto stylesheet = IceSpider::StylesheetCache::getDefault().get(rootDir / "xslt/transform.xslt")->get();
+		std::size_t total {};
+		for (auto _ : state) {
+			const auto before = allocations.load();
+			std::stringstream out;
+			Slicer::SerializeAny<IceSpider::XsltStreamSerializer>(complexes, out, stylesheet);
+			benchmark::DoNotOptimize(out);
+			total += allocations.load() - before;
+		}
+		state.counters["allocs"] = benchmark::Counter(static_cast<double>(total), benchmark::Counter::kAvgIterations);
+	}
+
+	// Mostly plain text, as query strings and cookies tend to be, with a space or an escape every so often
+	std::string
+	urlText(const std::size_t length)
+	{
+		std::string text;
+		text.reserve(length);
+		for (std::size_t chr = 0; chr < length; ++chr) {
+			text += (chr % 23 == 22) ? ' ' : (chr % 61 == 60) ? '&' : static_cast<char>('a' + (chr % 26));
+		}
+		return text;
+	}
+
+	void
+	UrlEncode(benchmark::State & state)
+	{
+		const auto text = urlText(static_cast<std::size_t>(state.range(0)));
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(IceSpider::XWwwFormUrlEncoded::urlencode(text));
+		}
+		state.SetBytesProcessed(state.iterations() * state.range(0));
+	}
+
+	void
+	UrlEncodeTo(benchmark::State & state)
+	{
+		const auto text = urlText(static_cast<std::size_t>(state.range(0)));
+		const std::string_view textView {text};
+		for (auto _ : state) {
+			std::stringstream out;
+			IceSpider::XWwwFormUrlEncoded::urlencodeto(out, textView.begin(), textView.end());
+			benchmark::DoNotOptimize(out);
+		}
+		state.SetBytesProcessed(state.iterations() * state.range(0));
+	}
+
+	void
+	UrlDecode(benchmark::State & state)
+	{
+		const auto encoded
+				= IceSpider::XWwwFormUrlEncoded::urlencode(urlText(static_cast<std::size_t>(state.range(0))));
+		const std::string_view text {encoded};
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(IceSpider::XWwwFormUrlEncoded::urlDecode(text.begin(), text.end()));
+		}
+		state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(encoded.length()));
+	}
+
+	void
+	FlatMapBulk(benchmark::State & state)
+	{
+		const auto keys = flatMapKeys(static_cast<std::size_t>(state.range(0)));
+		for (auto _ : state) {
+			IceSpider::FlatMap<std::string_view, std::string_view> map;
+			for (const auto & key : keys) {
+				map.append(key, key);
+			}
+			map.sort();
+			benchmark::DoNotOptimize(map);
+		}
+	}
 }
 
 BENCHMARK_CAPTURE_LITERAL(AcceptParse, "*/*");
@@ -140,4 +369,15 @@ BENCHMARK_CAPTURE_LITERAL(AcceptParse, "image/png;q=0.9, */*;q=1.0");
 BENCHMARK_CAPTURE_LITERAL(AcceptParse, "text/*");
 BENCHMARK_CAPTURE_LITERAL(AcceptParse, "text/html");
 
+BENCHMARK(FlatMapInsert)->Arg(40)->Arg(200)->Arg(1000);
+BENCHMARK(FlatMapBulk)->Arg(40)->Arg(200)->Arg(1000);
+
+BENCHMARK(UrlEncode)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK(UrlEncodeTo)->Arg(16)->Arg(256)->Arg(4096);
+BENCHMARK(UrlDecode)->Arg(16)->Arg(256)->Arg(4096);
+
+BENCHMARK_TEMPLATE(JsonSerialize, Slicer::JsonStreamSerializer)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(JsonSerialize, IceSpider::JsonStreamSerializer)->Arg(1000)->Arg(10000);
+BENCHMARK(XsltSerialize)->Arg(1)->Arg(100)->Arg(1000);
+
 BENCHMARK_MAIN();
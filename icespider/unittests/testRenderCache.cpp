@@ -0,0 +1,83 @@
+#define BOOST_TEST_MODULE RenderCache
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <renderCache.h>
+#include <slicer/modelParts.h>
+#include <slicer/slicer.h>
+#include <string>
+#include <test-api.h>
+
+namespace {
+	// Each entry's key and output, plus the allowance for its bookkeeping
+	constexpr std::size_t ENTRY = 1 + 100 + 128;
+
+	std::string
+	keyFor(const TestIceSpider::SomeModelPtr & model, const unsigned int version)
+	{
+		std::string key;
+		Slicer::ModelPart::OnRootFor(model, [&key, version](Slicer::ModelPartForRootParam root) {
+			key = IceSpider::RenderCache::key(root, version);
+		});
+		return key;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(miss_then_hit)
+{
+	IceSpider::RenderCache cache {ENTRY * 3};
+	BOOST_CHECK(!cache.find("a"));
+	cache.insert("a", std::string(100, 'a'));
+	const auto output = cache.find("a");
+	BOOST_REQUIRE(output);
+	BOOST_CHECK_EQUAL(*output, std::string(100, 'a'));
+	BOOST_CHECK_EQUAL(cache.size(), 1);
+	BOOST_CHECK_EQUAL(cache.bytes(), ENTRY);
+	BOOST_CHECK_EQUAL(cache.getHits(), 1);
+	BOOST_CHECK_EQUAL(cache.getMisses(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(evicts_least_recently_used)
+{
+	IceSpider::RenderCache cache {ENTRY * 3};
+	cache.insert("a", std::string(100, 'a'));
+	cache.insert("b", std::string(100, 'b'));
+	cache.insert("c", std::string(100, 'c'));
+	BOOST_REQUIRE(cache.find("a"));
+	cache.insert("d", std::string(100, 'd'));
+	BOOST_CHECK_EQUAL(cache.size(), 3);
+	BOOST_CHECK(!cache.find("b"));
+	BOOST_CHECK(cache.find("a"));
+	BOOST_CHECK(cache.find("c"));
+	BOOST_CHECK(cache.find("d"));
+	BOOST_CHECK_LE(cache.bytes(), cache.maxBytes);
+}
+
+BOOST_AUTO_TEST_CASE(replace)
+{
+	IceSpider::RenderCache cache {ENTRY * 3};
+	cache.insert("a", std::string(100, 'a'));
+	cache.insert("a", "new");
+	BOOST_CHECK_EQUAL(cache.size(), 1);
+	BOOST_CHECK_EQUAL(*cache.find("a"), "new");
+}
+
+BOOST_AUTO_TEST_CASE(too_large)
+{
+	IceSpider::RenderCache cache {ENTRY * 3};
+	cache.insert("a", std::string(100, 'a'));
+	cache.insert("big", std::string(ENTRY * 3, 'b'));
+	BOOST_CHECK(!cache.find("big"));
+	// Nothing was evicted to make room for it
+	BOOST_CHECK(cache.find("a"));
+}
+
+BOOST_AUTO_TEST_CASE(key_by_model_and_version)
+{
+	const auto model = std::make_shared<TestIceSpider::SomeModel>("value");
+	const auto key = keyFor(model, 1);
+	BOOST_CHECK_EQUAL(key, keyFor(std::make_shared<TestIceSpider::SomeModel>("value"), 1));
+	BOOST_CHECK_NE(key, keyFor(model, 2));
+	BOOST_CHECK_NE(key, keyFor(std::make_shared<TestIceSpider::SomeModel>("other"), 1));
+	BOOST_CHECK_NE(key, keyFor(nullptr, 1));
+}
@@ -0,0 +1,158 @@
+#define BOOST_TEST_MODULE SerializerTable
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <http.h>
+#include <ihttpRequest.h>
+#include <irouteHandler.h>
+#include <jsonStreamSerializer.h>
+#include <memory>
+#include <plugins.h>
+#include <serializerTable.h>
+#include <slicer/serializer.h>
+#include <string_view>
+
+using IceSpider::SerializerTable;
+
+namespace {
+	// Registers a serializer for as long as it lives
+	class Registered {
+	public:
+		explicit Registered(std::string_view name) : name {name}
+		{
+			AdHoc::PluginManager::getDefault()->add<Slicer::StreamSerializerFactory>(
+					std::make_shared<IceSpider::JsonStreamSerializer::IceSpiderFactory>(), name, __FILE__, __LINE__);
+		}
+
+		~Registered()
+		{
+			AdHoc::PluginManager::getDefault()->remove<Slicer::StreamSerializerFactory>(name);
+		}
+
+		Registered(const Registered &) = delete;
+		Registered(Registered &&) = delete;
+		Registered & operator=(const Registered &) = delete;
+		Registered & operator=(Registered &&) = delete;
+
+	private:
+		std::string_view name;
+	};
+
+	// A route built without a Core, with serializers of its own
+	class OwnSerializersRoute : public IceSpider::IRouteHandler {
+	public:
+		OwnSerializersRoute() : IRouteHandler(IceSpider::HttpMethod::GET, "/")
+		{
+			addRouteSerializer({.group = "zzz", .type = "own"}, own);
+			addRouteSerializer({.group = "application", .type = "json"}, own);
+		}
+
+		void
+		execute(IceSpider::IHttpRequest *) const override
+		{
+		}
+
+		const StreamSerializerFactoryPtr own {std::make_shared<IceSpider::JsonStreamSerializer::IceSpiderFactory>()};
+	};
+
+	void
+	checkEntry(const SerializerTable::Entry * entry, std::string_view group, std::string_view type)
+	{
+		BOOST_REQUIRE(entry);
+		BOOST_CHECK_EQUAL(entry->first.group, group);
+		BOOST_CHECK_EQUAL(entry->first.type, type);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(own_json)
+{
+	const SerializerTable table;
+	const auto * json = table.find({.group = "application", .type = "json"});
+	checkEntry(json, "application", "json");
+	BOOST_CHECK(dynamic_cast<const IceSpider::JsonStreamSerializer::IceSpiderFactory *>(json->second.get()));
+}
+
+BOOST_AUTO_TEST_CASE(configured_json)
+{
+	const Registered fake {"application/fake"};
+	const auto plugin = AdHoc::PluginManager::getDefault()->get<Slicer::StreamSerializerFactory>("application/fake");
+	const SerializerTable table {"application/fake"};
+	const auto * json = table.find({.group = "application", .type = "json"});
+	checkEntry(json, "application", "json");
+	BOOST_CHECK_EQUAL(json->second, plugin->implementation());
+	BOOST_CHECK_THROW(SerializerTable {"nosuch"}, AdHoc::NoSuchPluginException);
+}
+
+BOOST_AUTO_TEST_CASE(own_json_plugin_unlisted)
+{
+	const SerializerTable table;
+	BOOST_CHECK(!table.find({.group = "icespider"}));
+}
+
+BOOST_AUTO_TEST_CASE(entries_sorted)
+{
+	const Registered textFake {"text/fake"};
+	const Registered appFake {"application/fake"};
+	const SerializerTable table;
+	const auto & entries = table.getEntries();
+	BOOST_REQUIRE(!entries.empty());
+	BOOST_CHECK(std::ranges::is_sorted(entries, {}, &SerializerTable::Entry::first));
+	// Anything matches the first
+	BOOST_CHECK_EQUAL(table.find({}), &entries.front());
+}
+
+BOOST_AUTO_TEST_CASE(wildcards)
+{
+	const Registered fake {"application/fake"};
+	const SerializerTable table;
+	// application/fake sorts before application/json
+	checkEntry(table.find({.group = "application"}), "application", "fake");
+	checkEntry(table.find({.type = "json"}), "application", "json");
+	checkEntry(table.find({.group = "application", .type = "json"}), "application", "json");
+}
+
+BOOST_AUTO_TEST_CASE(unknown_names)
+{
+	const SerializerTable table;
+	BOOST_CHECK(!table.find({.group = "nosuch"}));
+	BOOST_CHECK(!table.find({.type = "nosuch"}));
+	BOOST_CHECK(!table.find({.group = "application", .type = "nosuch"}));
+	BOOST_CHECK(!table.find({.group = "nosuch", .type = "json"}));
+}
+
+BOOST_AUTO_TEST_CASE(interned_across_groups_and_types)
+{
+	// The same name as a group in one entry and a type in another shares its id, but only matches where it's used
+	const Registered fake {"json/application"};
+	const SerializerTable table;
+	checkEntry(table.find({.group = "json"}), "json", "application");
+	checkEntry(table.find({.type = "application"}), "json", "application");
+	checkEntry(table.find({.group = "application", .type = "json"}), "application", "json");
+	BOOST_CHECK(!table.find({.group = "json", .type = "json"}));
+	BOOST_CHECK(!table.find({.group = "application", .type = "application"}));
+}
+
+BOOST_AUTO_TEST_CASE(registered_later)
+{
+	const SerializerTable before;
+	BOOST_CHECK(!before.find({.group = "test", .type = "late"}));
+	const Registered late {"test/late"};
+	const SerializerTable after;
+	checkEntry(after.find({.group = "test", .type = "late"}), "test", "late");
+	// Built tables are unchanged
+	BOOST_CHECK(!before.find({.group = "test", .type = "late"}));
+}
+
+BOOST_AUTO_TEST_CASE(route_without_core)
+{
+	const Registered fake {"application/fake"};
+	const OwnSerializersRoute route;
+	// Own and registered serializers are searched together, in MimeType order
+	checkEntry(route.findSerializer({}), "application", "fake");
+	checkEntry(route.findSerializer({.type = "own"}), "zzz", "own");
+	// An own serializer replaces a registered one of the same type
+	const auto * json = route.findSerializer({.group = "application", .type = "json"});
+	checkEntry(json, "application", "json");
+	BOOST_CHECK_EQUAL(json->second, route.own);
+	BOOST_CHECK_EQUAL(route.getDefaultSerializerFactory(), route.own);
+}
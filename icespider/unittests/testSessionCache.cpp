@@ -0,0 +1,123 @@
+#define BOOST_TEST_MODULE SessionCache
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <session.h>
+#include <sessionCache.h>
+#include <string>
+#include <vector>
+
+namespace {
+	// Ids which share a shard, so compete for the same share of the capacity
+	std::vector<std::string>
+	sameShard(const std::size_t count)
+	{
+		const auto shardOf = [](const std::string & id) {
+			return std::hash<std::string> {}(id) % IceSpider::SessionCache::SHARDS;
+		};
+		std::vector<std::string> ids {"session0"};
+		for (std::size_t candidate = 1; ids.size() < count; ++candidate) {
+			if (auto id = "session" + std::to_string(candidate); shardOf(id) == shardOf(ids.front())) {
+				ids.push_back(std::move(id));
+			}
+		}
+		return ids;
+	}
+
+	IceSpider::SessionPtr
+	session(const std::string & id, const short duration = 0)
+	{
+		return std::make_shared<IceSpider::Session>(id, 0, duration, IceSpider::Variables {});
+	}
+}
+
+BOOST_AUTO_TEST_CASE(copies)
+{
+	IceSpider::SessionCache cache {IceSpider::SessionCache::SHARDS};
+	const auto original = session("a");
+	cache.insert(original, std::nullopt, false);
+	original->duration = 1;
+	const auto found = cache.find("a");
+	BOOST_REQUIRE(found);
+	BOOST_CHECK_NE(found->session, original);
+	BOOST_CHECK_EQUAL(found->session->duration, 0);
+	found->session->duration = 2;
+	BOOST_CHECK_EQUAL(cache.find("a")->session->duration, 0);
+}
+
+BOOST_AUTO_TEST_CASE(evicts_least_recently_used)
+{
+	const auto ids = sameShard(3);
+	IceSpider::SessionCache cache {IceSpider::SessionCache::SHARDS * 2};
+	cache.insert(session(ids[0]), std::nullopt, false);
+	cache.insert(session(ids[1]), std::nullopt, false);
+	BOOST_REQUIRE(cache.find(ids[0]));
+	cache.insert(session(ids[2]), std::nullopt, false);
+	BOOST_CHECK_EQUAL(cache.size(), 2);
+	BOOST_CHECK(cache.find(ids[0]));
+	BOOST_CHECK(!cache.find(ids[1]));
+	BOOST_CHECK(cache.find(ids[2]));
+}
+
+BOOST_AUTO_TEST_CASE(dirty_pinned)
+{
+	const auto ids = sameShard(3);
+	IceSpider::SessionCache cache {IceSpider::SessionCache::SHARDS};
+	cache.insert(session(ids[0]), std::nullopt, true);
+	cache.insert(session(ids[1]), std::nullopt, true);
+	cache.insert(session(ids[2]), std::nullopt, false);
+	BOOST_CHECK(cache.find(ids[0]));
+	BOOST_CHECK(cache.find(ids[1]));
+	BOOST_CHECK_EQUAL(cache.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(take_dirty)
+{
+	const auto ids = sameShard(3);
+	IceSpider::SessionCache cache {IceSpider::SessionCache::SHARDS};
+	cache.insert(session(ids[0]), std::nullopt, true);
+	cache.insert(session("clean"), std::nullopt, false);
+	const auto taken = cache.takeDirty();
+	BOOST_REQUIRE_EQUAL(taken.size(), 1);
+	BOOST_CHECK_EQUAL(taken.front().session->id, ids[0]);
+
+	// Until it's written, it's still pinned, and taken again
+	cache.insert(session(ids[1]), std::nullopt, false);
+	BOOST_CHECK(cache.find(ids[0]));
+	BOOST_CHECK_EQUAL(cache.takeDirty().size(), 1);
+
+	cache.written(ids[0], taken.front().generation);
+	BOOST_CHECK(cache.takeDirty().empty());
+	cache.insert(session(ids[2]), std::nullopt, false);
+	BOOST_CHECK(!cache.find(ids[0]));
+}
+
+BOOST_AUTO_TEST_CASE(changed_while_writing)
+{
+	IceSpider::SessionCache cache {IceSpider::SessionCache::SHARDS};
+	cache.insert(session("a", 1), std::nullopt, true);
+	const auto taken = cache.takeDirty();
+	BOOST_REQUIRE_EQUAL(taken.size(), 1);
+	cache.insert(session("a", 2), std::nullopt, true);
+	// The write of the earlier change doesn't make the later one clean
+	cache.written("a", taken.front().generation);
+	const auto again = cache.takeDirty();
+	BOOST_REQUIRE_EQUAL(again.size(), 1);
+	BOOST_CHECK_EQUAL(again.front().session->duration, 2);
+	cache.written("a", again.front().generation);
+	BOOST_CHECK(cache.takeDirty().empty());
+}
+
+BOOST_AUTO_TEST_CASE(erased)
+{
+	IceSpider::SessionCache cache {IceSpider::SessionCache::SHARDS};
+	cache.insert(session("a"), std::nullopt, true);
+	const auto taken = cache.takeDirty();
+	cache.erase("a");
+	cache.written("a", taken.front().generation);
+	BOOST_CHECK(!cache.find("a"));
+	BOOST_CHECK_EQUAL(cache.size(), 0);
+}
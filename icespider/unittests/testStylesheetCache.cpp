@@ -0,0 +1,155 @@
+#define BOOST_TEST_MODULE StylesheetCache
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <libxslt/xsltInternals.h>
+#include <string>
+#include <string_view>
+#include <stylesheetCache.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+	constexpr std::string_view STYLESHEET_HEAD = R"X(<xsl:stylesheet version="1.0")X"
+												 R"X( xmlns:xsl="http://www.w3.org/1999/XSL/Transform">)X"
+												 R"X(<xsl:output method=")X";
+	constexpr std::string_view STYLESHEET_TAIL = R"X("/></xsl:stylesheet>)X";
+
+	class StylesheetFixture {
+	public:
+		StylesheetFixture() :
+			directory(std::filesystem::temp_directory_path() / ("stylesheetCache." + std::to_string(getpid())))
+		{
+			std::filesystem::create_directories(directory);
+		}
+
+		StylesheetFixture(const StylesheetFixture &) = delete;
+		StylesheetFixture(StylesheetFixture &&) = delete;
+		StylesheetFixture & operator=(const StylesheetFixture &) = delete;
+		StylesheetFixture & operator=(StylesheetFixture &&) = delete;
+
+		~StylesheetFixture()
+		{
+			std::filesystem::remove_all(directory);
+		}
+
+		// Written with a distinct modification time, however quickly it follows the last
+		void
+		write(const std::string_view content)
+		{
+			{
+				std::ofstream out(path);
+				out << content;
+			}
+			std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() + ++writes * 1s);
+		}
+
+		void
+		writeMethod(const std::string_view method)
+		{
+			write(std::string {STYLESHEET_HEAD}.append(method).append(STYLESHEET_TAIL));
+		}
+
+		[[nodiscard]] static bool
+		waitForVersion(const IceSpider::StylesheetCache::EntryPtr & entry, const unsigned int version)
+		{
+			for (auto wait = 0; wait < 500 && entry->getVersion() < version; ++wait) {
+				std::this_thread::sleep_for(10ms);
+			}
+			return entry->getVersion() >= version;
+		}
+
+		const std::filesystem::path directory;
+		const std::filesystem::path path {directory / "sheet.xslt"};
+		int writes {};
+		IceSpider::StylesheetCache cache;
+	};
+
+	std::string_view
+	method(const IceSpider::StylesheetCache::StylesheetPtr & stylesheet)
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		return reinterpret_cast<const char *>(stylesheet->method);
+	}
+}
+
+BOOST_FIXTURE_TEST_SUITE(cache, StylesheetFixture)
+
+BOOST_AUTO_TEST_CASE(shared_by_path)
+{
+	writeMethod("xml");
+	const auto entry = cache.get(path);
+	BOOST_CHECK_EQUAL(entry, cache.get(directory / "." / "sheet.xslt"));
+	BOOST_CHECK_EQUAL(entry->getVersion(), 0);
+	const auto stylesheet = entry->get();
+	BOOST_REQUIRE(stylesheet);
+	BOOST_CHECK_EQUAL(entry->getVersion(), 1);
+	BOOST_CHECK_EQUAL(stylesheet, entry->get());
+	BOOST_CHECK_EQUAL(method(stylesheet), "xml");
+}
+
+BOOST_AUTO_TEST_CASE(reload_on_change)
+{
+	writeMethod("xml");
+	const auto entry = cache.get(path);
+	const auto original = entry->get();
+	writeMethod("html");
+	BOOST_REQUIRE(waitForVersion(entry, 2));
+	BOOST_CHECK_EQUAL(method(entry->get()), "html");
+	// Still valid for anything using it when the new one was published
+	BOOST_CHECK_EQUAL(method(original), "xml");
+}
+
+BOOST_AUTO_TEST_CASE(reload_by_polling)
+{
+	cache.setPollInterval(20ms);
+	writeMethod("xml");
+	const auto entry = cache.get(path);
+	BOOST_REQUIRE(entry->get());
+	writeMethod("html");
+	BOOST_REQUIRE(waitForVersion(entry, 2));
+	BOOST_CHECK_EQUAL(method(entry->get()), "html");
+}
+
+BOOST_AUTO_TEST_CASE(reload_unwatched_directory)
+{
+	// inotify can't watch a directory which doesn't exist yet, so this entry is polled instead
+	const auto subdirectory = directory / "later";
+	const auto entry = cache.get(subdirectory / "sheet.xslt");
+	std::filesystem::create_directories(subdirectory);
+	writeMethod("xml");
+	std::filesystem::copy_file(path, entry->path);
+	BOOST_REQUIRE(entry->get());
+	writeMethod("html");
+	std::filesystem::copy_file(path, entry->path, std::filesystem::copy_options::overwrite_existing);
+	std::filesystem::last_write_time(entry->path, std::filesystem::last_write_time(path));
+	BOOST_REQUIRE(waitForVersion(entry, 2));
+	BOOST_CHECK_EQUAL(method(entry->get()), "html");
+}
+
+BOOST_AUTO_TEST_CASE(keep_old_when_broken)
+{
+	writeMethod("xml");
+	const auto entry = cache.get(path);
+	BOOST_REQUIRE(entry->get());
+	write("not a stylesheet");
+	std::this_thread::sleep_for(100ms);
+	BOOST_CHECK_EQUAL(entry->getVersion(), 1);
+	BOOST_CHECK_EQUAL(method(entry->get()), "xml");
+	writeMethod("html");
+	BOOST_REQUIRE(waitForVersion(entry, 2));
+	BOOST_CHECK_EQUAL(method(entry->get()), "html");
+}
+
+BOOST_AUTO_TEST_CASE(missing)
+{
+	const auto entry = cache.get(directory / "missing.xslt");
+	BOOST_CHECK_THROW((void)entry->get(), std::exception);
+	BOOST_CHECK_EQUAL(entry->getVersion(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+#define BOOST_TEST_MODULE UrlScan
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <urlScan.h>
+#include <xwwwFormUrlEncoded.h>
+
+namespace {
+	// Plain text of the given length with c at pos, which covers each lane of each kernel and the tails after them
+	std::string
+	withChar(const std::size_t length, const std::size_t pos, const char chr)
+	{
+		constexpr std::string_view PLAIN {"aZ09-._~"};
+		std::string value(length, 'a');
+		for (std::size_t idx = 0; idx < length; ++idx) {
+			value[idx] = PLAIN[idx % PLAIN.length()];
+		}
+		if (pos < length) {
+			value[pos] = chr;
+		}
+		return value;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(kernels_agree)
+{
+	const auto kernels = IceSpider::UrlScan::supportedKernels();
+	BOOST_REQUIRE(!kernels.empty());
+	BOOST_REQUIRE_EQUAL(kernels.back().name, "scalar");
+	const auto & scalar = kernels.back();
+	for (std::size_t length = 0; length < 67; ++length) {
+		for (std::size_t pos = 0; pos <= length; ++pos) {
+			for (int chr = 0; chr < 256; ++chr) {
+				const auto value = withChar(length, pos, static_cast<char>(chr));
+				for (const auto & kernel : kernels) {
+					BOOST_TEST_INFO(kernel.name << " " << length << " " << pos << " " << chr);
+					BOOST_CHECK_EQUAL(kernel.decodePlainPrefix(value), scalar.decodePlainPrefix(value));
+					BOOST_CHECK_EQUAL(kernel.encodePlainPrefix(value), scalar.encodePlainPrefix(value));
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(plain_prefixes)
+{
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::decodePlainPrefix(""), 0);
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::decodePlainPrefix("some text"), 9);
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::decodePlainPrefix("some+text"), 4);
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::decodePlainPrefix("%20"), 0);
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::encodePlainPrefix("Some-text_1.0~"), 14);
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::encodePlainPrefix("some text"), 4);
+	BOOST_CHECK_EQUAL(IceSpider::UrlScan::encodePlainPrefix("@"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+	for (int chr = 1; chr < 256; ++chr) {
+		const auto value = withChar(70, 40, static_cast<char>(chr)) + " and then some";
+		const auto encoded = IceSpider::XWwwFormUrlEncoded::urlencode(value);
+		const std::string_view encodedView {encoded};
+		const auto decoded = IceSpider::XWwwFormUrlEncoded::urlDecode(encodedView.begin(), encodedView.end());
+		BOOST_TEST_INFO(chr);
+		BOOST_CHECK_EQUAL(std::string_view {decoded}, value);
+	}
+	BOOST_CHECK_EQUAL(IceSpider::XWwwFormUrlEncoded::urlencode("a b&c=\xff"), "a+b%26c%3d%ff");
+}
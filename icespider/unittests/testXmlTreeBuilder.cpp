@@ -0,0 +1,160 @@
+#define BOOST_TEST_MODULE XmlTreeBuilder
+#include <boost/test/unit_test.hpp>
+
+#include <Ice/Config.h>
+#include <libxml++/document.h>
+#include <libxml/tree.h>
+#include <libxml/xmlmemory.h>
+#include <limits>
+#include <memory>
+#include <slicer/modelParts.h>
+#include <slicer/slicer.h>
+#include <slicer/xml/serializer.h>
+#include <string>
+#include <test-serializers.h>
+#include <tuple>
+#include <xmlTreeBuilder.h>
+
+namespace {
+	// Gives access to the document Slicer builds
+	class SlicerDocument : public Slicer::XmlDocumentSerializer {
+	public:
+		using Slicer::XmlDocumentSerializer::doc;
+	};
+
+	std::string
+	dump(const xmlDocPtr doc)
+	{
+		xmlChar * buffer {};
+		int length {};
+		xmlDocDumpMemory(doc, &buffer, &length);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		std::string out {reinterpret_cast<const char *>(buffer), static_cast<std::string::size_type>(length)};
+		xmlFree(buffer);
+		return out;
+	}
+
+	template<typename Model>
+	IceSpider::XmlDocPtr
+	build(const Model & model)
+	{
+		IceSpider::XmlDocPtr doc {nullptr, &xmlFreeDoc};
+		Slicer::ModelPart::OnRootFor(model, [&doc](Slicer::ModelPartForRootParam root) {
+			doc = IceSpider::XmlTreeBuilder::build(root);
+		});
+		return doc;
+	}
+
+	// Ours must build the same document as slicer's own, for everything it doesn't hand back to it
+	template<typename Model>
+	void
+	checkSameAsSlicer(const Model & model)
+	{
+		const auto ours = build(model);
+		BOOST_REQUIRE(ours);
+		SlicerDocument slicers;
+		Slicer::ModelPart::OnRootFor(model, [&slicers](Slicer::ModelPartForRootParam root) {
+			slicers.Serialize(root);
+		});
+		BOOST_CHECK_EQUAL(dump(ours.get()), dump(slicers.doc.cobj()));
+	}
+
+	// Everything XmlTreeBuilder builds itself: no subclasses, no nulls
+	TestSerializers::EverythingPtr
+	everything()
+	{
+		auto model = std::make_shared<TestSerializers::Everything>();
+		model->flag = true;
+		model->small = std::numeric_limits<Ice::Byte>::max();
+		model->medium = std::numeric_limits<Ice::Short>::min();
+		model->large = -1;
+		model->huge = std::numeric_limits<Ice::Long>::max();
+		model->single = 0.1F;
+		model->dbl = 1.0 / 3;
+		model->text = "text with <markup> & a\nline break";
+		model->colour = TestSerializers::Colour::Blue;
+		model->original = "renamed only in JSON";
+		model->maybeText = "present";
+		model->maybeNumber = 0;
+		model->nested = std::make_shared<TestSerializers::Base>(1);
+		model->bases = {std::make_shared<TestSerializers::Base>(2), std::make_shared<TestSerializers::Base>(3)};
+		model->colours = {TestSerializers::Colour::Red, TestSerializers::Colour::Green};
+		model->bytes = {0, 1, std::numeric_limits<Ice::Byte>::max()};
+		model->doubles = {0, 0.1, -1.5, 1e300, std::numeric_limits<Ice::Double>::denorm_min()};
+		model->intNames = {{-1, "minus one"}, {1, "one"}};
+		model->namedInts = {{"", 0}, {"one", 1}};
+		model->longKeyed = {{std::numeric_limits<Ice::Long>::min(), "min"}, {0, "zero"}};
+		return model;
+	}
+
+	using XmlSpecific = std::tuple<TestSerializers::XmlAttribute, TestSerializers::XmlText, TestSerializers::XmlBare,
+			TestSerializers::XmlAttributes, TestSerializers::XmlElements, TestSerializers::XmlElementsType>;
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_defaults)
+{
+	checkSameAsSlicer(std::make_shared<TestSerializers::Everything>());
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_everything)
+{
+	checkSameAsSlicer(everything());
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_optionals)
+{
+	auto model = everything();
+	model->maybeText.reset();
+	model->maybeNumber.reset();
+	model->nested.reset();
+	checkSameAsSlicer(model);
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_collections)
+{
+	const auto model = everything();
+	checkSameAsSlicer(model->bases);
+	checkSameAsSlicer(model->colours);
+	checkSameAsSlicer(model->bytes);
+	checkSameAsSlicer(model->doubles);
+	checkSameAsSlicer(model->intNames);
+	checkSameAsSlicer(model->namedInts);
+	checkSameAsSlicer(TestSerializers::Bases {});
+	checkSameAsSlicer(TestSerializers::NamedInts {});
+}
+
+BOOST_AUTO_TEST_CASE(same_as_slicer_simple)
+{
+	checkSameAsSlicer(true);
+	checkSameAsSlicer(false);
+	checkSameAsSlicer(Ice::Byte {7});
+	checkSameAsSlicer(Ice::Int {-7});
+	checkSameAsSlicer(Ice::Float {2.1F});
+	checkSameAsSlicer(Ice::Double {0.1});
+	checkSameAsSlicer(std::numeric_limits<Ice::Double>::max());
+	checkSameAsSlicer(std::string {"<&>"});
+	checkSameAsSlicer(TestSerializers::Colour::Green);
+}
+
+BOOST_AUTO_TEST_CASE(fallback_null)
+{
+	BOOST_CHECK(!build(TestSerializers::EverythingPtr {}));
+}
+
+BOOST_AUTO_TEST_CASE(fallback_null_in_sequence)
+{
+	BOOST_CHECK(!build(TestSerializers::Bases {std::make_shared<TestSerializers::Base>(1), nullptr}));
+}
+
+BOOST_AUTO_TEST_CASE(fallback_type_id)
+{
+	BOOST_CHECK(!build(TestSerializers::BasePtr {std::make_shared<TestSerializers::Derived>(1, "derived")}));
+	auto model = everything();
+	model->nested = std::make_shared<TestSerializers::Derived>(1, "derived");
+	BOOST_CHECK(!build(model));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(fallback_xml_metadata, Model, XmlSpecific)
+{
+	BOOST_CHECK(!build(std::make_shared<Model>()));
+}
@@ -0,0 +1,221 @@
+#include "renderCache.h"
+#include <Ice/Config.h>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <slicer/modelParts.h>
+#include <utility>
+
+namespace IceSpider {
+	namespace {
+		// Roughly what each entry costs beyond its key and output: list and index nodes, and the output's control block
+		constexpr std::size_t ENTRY_OVERHEAD = 128;
+
+		// Every value starts with one of these, and the members of a complex value each with Member, so that no two
+		// different models can encode the same
+		enum class Tag : char {
+			Null = 'N',
+			False = 'f',
+			True = 't',
+			Byte = 'b',
+			Short = 's',
+			Int = 'i',
+			Long = 'l',
+			Float = 'F',
+			Double = 'D',
+			String = 'S',
+			Complex = 'C',
+			TypeId = 'T',
+			Member = 'M',
+			Items = 'Q',
+			End = 'E',
+		};
+
+		void
+		put(std::string & key, const Tag tag)
+		{
+			key += static_cast<char>(tag);
+		}
+
+		template<typename Value>
+		void
+		putRaw(std::string & key, const Value value)
+		{
+			const auto bytes = std::bit_cast<std::array<char, sizeof(Value)>>(value);
+			key.append(bytes.data(), bytes.size());
+		}
+
+		void
+		putString(std::string & key, const std::string_view value)
+		{
+			putRaw(key, static_cast<uint64_t>(value.length()));
+			key.append(value);
+		}
+
+		class KeyValueTarget : public Slicer::ValueTarget {
+		public:
+			explicit KeyValueTarget(std::string & key) : key(key) { }
+
+			void
+			get(const bool & value) const override
+			{
+				put(key, value ? Tag::True : Tag::False);
+			}
+
+			void
+			get(const std::string & value) const override
+			{
+				put(key, Tag::String);
+				putString(key, value);
+			}
+
+#define GET(T, TAG) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void get(const T & value) const override \
+	{ \
+		put(key, Tag::TAG); \
+		putRaw(key, value); \
+	}
+
+			GET(Ice::Byte, Byte);
+			GET(Ice::Short, Short);
+			GET(Ice::Int, Int);
+			GET(Ice::Long, Long);
+			GET(Ice::Float, Float);
+			GET(Ice::Double, Double);
+#undef GET
+
+		private:
+			std::string & key;
+		};
+
+		void
+		// NOLINTNEXTLINE(misc-no-recursion)
+		putModelPart(std::string & key, const Slicer::ModelPartParam modelPart)
+		{
+			if (!modelPart || !modelPart->HasValue()) {
+				put(key, Tag::Null);
+				return;
+			}
+			switch (modelPart->GetType()) {
+				case Slicer::ModelPartType::Null:
+					put(key, Tag::Null);
+					break;
+				case Slicer::ModelPartType::Simple:
+					modelPart->GetValue(KeyValueTarget {key});
+					break;
+				case Slicer::ModelPartType::Complex:
+					put(key, Tag::Complex);
+					if (const auto typeId = modelPart->GetTypeId()) {
+						put(key, Tag::TypeId);
+						putString(key, *typeId);
+					}
+					modelPart->OnEachChild([&key](const auto & name, auto child, auto) {
+						put(key, Tag::Member);
+						putString(key, name);
+						putModelPart(key, child);
+					});
+					put(key, Tag::End);
+					break;
+				case Slicer::ModelPartType::Sequence:
+				case Slicer::ModelPartType::Dictionary:
+					put(key, Tag::Items);
+					modelPart->OnEachChild([&key](const auto &, auto child, auto) {
+						putModelPart(key, child);
+					});
+					put(key, Tag::End);
+					break;
+			}
+		}
+	}
+
+	RenderCache::RenderCache(const std::size_t maxBytes) : maxBytes(maxBytes) { }
+
+	std::string
+	RenderCache::key(Slicer::ModelPartForRootParam modelPart, const unsigned int version)
+	{
+		std::string key;
+		putRaw(key, version);
+		modelPart->OnEachChild([&key](const auto & name, auto child, auto) {
+			putString(key, name);
+			putModelPart(key, child);
+		});
+		return key;
+	}
+
+	RenderCache::Output
+	RenderCache::find(const std::string_view key)
+	{
+		const std::lock_guard guard {lock};
+		const auto entry = index.find(key);
+		if (entry == index.end()) {
+			++misses;
+			return {};
+		}
+		++hits;
+		entries.splice(entries.begin(), entries, entry->second);
+		return entry->second->output;
+	}
+
+	void
+	RenderCache::insert(std::string key, std::string output)
+	{
+		Entry entry {.key = std::move(key), .output = std::make_shared<const std::string>(std::move(output))};
+		const auto entryCost = cost(entry);
+		if (entryCost > maxBytes) {
+			return;
+		}
+		const std::lock_guard guard {lock};
+		if (const auto existing = index.find(entry.key); existing != index.end()) {
+			erase(existing->second);
+		}
+		while (used + entryCost > maxBytes) {
+			erase(std::prev(entries.end()));
+		}
+		entries.push_front(std::move(entry));
+		// Views the key in its list node, which stays put until the entry is erased
+		index.emplace(entries.front().key, entries.begin());
+		used += entryCost;
+	}
+
+	std::size_t
+	RenderCache::cost(const Entry & entry)
+	{
+		return entry.key.length() + entry.output->length() + ENTRY_OVERHEAD;
+	}
+
+	void
+	RenderCache::erase(const Entries::iterator entry)
+	{
+		used -= cost(*entry);
+		index.erase(entry->key);
+		entries.erase(entry);
+	}
+
+	std::size_t
+	RenderCache::size() const
+	{
+		const std::lock_guard guard {lock};
+		return entries.size();
+	}
+
+	std::size_t
+	RenderCache::bytes() const
+	{
+		const std::lock_guard guard {lock};
+		return used;
+	}
+
+	std::size_t
+	RenderCache::getHits() const
+	{
+		return hits;
+	}
+
+	std::size_t
+	RenderCache::getMisses() const
+	{
+		return misses;
+	}
+}
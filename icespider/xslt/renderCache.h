@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <c++11Helpers.h>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <slicer/modelParts.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <visibility.h>
+
+namespace IceSpider {
+	// Thread safe memo of rendered output, by the model and stylesheet version it was rendered from. Keys are a
+	// compact encoding of every name and value in the model, compared in full on lookup, so a hash collision can never
+	// serve one model's page for another. The least recently used entries are evicted to stay within a byte budget.
+	class DLL_PUBLIC RenderCache {
+	public:
+		using Output = std::shared_ptr<const std::string>;
+
+		explicit RenderCache(std::size_t maxBytes);
+		SPECIAL_MEMBERS_DELETE(RenderCache);
+		~RenderCache() = default;
+
+		// Identifies what modelPart contains, and the stylesheet version it's to be rendered with
+		[[nodiscard]] static std::string key(Slicer::ModelPartForRootParam modelPart, unsigned int version);
+
+		[[nodiscard]] Output find(std::string_view key);
+		// Outputs which would take more than the whole budget aren't kept
+		void insert(std::string key, std::string output);
+
+		[[nodiscard]] std::size_t size() const;
+		// Including an allowance for each entry's bookkeeping
+		[[nodiscard]] std::size_t bytes() const;
+		[[nodiscard]] std::size_t getHits() const;
+		[[nodiscard]] std::size_t getMisses() const;
+
+		const std::size_t maxBytes;
+
+	private:
+		struct Entry {
+			std::string key;
+			Output output;
+		};
+
+		using Entries = std::list<Entry>;
+
+		[[nodiscard]] static std::size_t cost(const Entry &);
+		void erase(Entries::iterator);
+
+		mutable std::mutex lock;
+		// Most recently used first
+		Entries entries;
+		std::unordered_map<std::string_view, Entries::iterator> index;
+		std::size_t used {};
+		std::atomic<std::size_t> hits {};
+		std::atomic<std::size_t> misses {};
+	};
+}
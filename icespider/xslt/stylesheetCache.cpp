@@ -0,0 +1,221 @@
+#include "stylesheetCache.h"
+#include <Ice/Properties.h>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <core.h>
+#include <cstdint>
+#include <libxml++/exceptions/exception.h>
+#include <libxslt/xsltInternals.h>
+#include <plugins.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace IceSpider {
+	namespace {
+		// Editors either rewrite a file in place or replace it; touching it also counts
+		constexpr uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB;
+		constexpr std::size_t EVENT_BUFFER = 4096;
+		constexpr auto POLL_INTERVAL = "IceSpider.XsltStreamSerializer.PollInterval";
+
+		// Sets the default cache's poll interval, in milliseconds, if the property is given
+		class PollIntervalConfigurator : public Configurator {
+		public:
+			void
+			configure(const Ice::PropertiesPtr & properties) const override
+			{
+				if (const auto interval = properties->getPropertyAsIntWithDefault(POLL_INTERVAL, -1); interval >= 0) {
+					StylesheetCache::getDefault().setPollInterval(std::chrono::milliseconds {interval});
+				}
+			}
+		};
+	}
+
+	StylesheetCache::Entry::Entry(std::filesystem::path path) : path(std::move(path)) { }
+
+	StylesheetCache::StylesheetPtr
+	StylesheetCache::Entry::get()
+	{
+		if (auto current = stylesheet.load()) {
+			return current;
+		}
+		const std::lock_guard guard {loadLock};
+		if (!stylesheet.load()) {
+			load();
+		}
+		return stylesheet.load();
+	}
+
+	unsigned int
+	StylesheetCache::Entry::getVersion() const
+	{
+		return version.load();
+	}
+
+	void
+	StylesheetCache::Entry::load()
+	{
+		std::error_code error;
+		const auto newWriteTime = std::filesystem::last_write_time(path, error);
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto * parsed = xsltParseStylesheetFile(reinterpret_cast<const unsigned char *>(path.c_str()));
+		if (!parsed) {
+			throw xmlpp::exception("Failed to load stylesheet");
+		}
+		stylesheet.store({parsed, xsltFreeStylesheet});
+		++version;
+		writeTime = newWriteTime;
+	}
+
+	void
+	StylesheetCache::Entry::refresh()
+	{
+		const std::lock_guard guard {loadLock};
+		// Not used yet; it'll be loaded when it is
+		if (!stylesheet.load()) {
+			return;
+		}
+		std::error_code error;
+		if (const auto newWriteTime = std::filesystem::last_write_time(path, error);
+				error || newWriteTime == writeTime) {
+			return;
+		}
+		try {
+			load();
+		}
+		catch (const xmlpp::exception &) {
+			// Probably caught mid write; keep serving the old one until the next change
+		}
+	}
+
+	StylesheetCache::StylesheetCache() :
+		wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), inotifyFd(inotify_init1(IN_CLOEXEC | IN_NONBLOCK))
+	{
+		if (wakeFd < 0) {
+			throw std::system_error(errno, std::generic_category(), "eventfd");
+		}
+	}
+
+	StylesheetCache::~StylesheetCache()
+	{
+		// The watcher needs wakeFd until it has stopped
+		if (watcher.joinable()) {
+			watcher.request_stop();
+			watcher.join();
+		}
+		close(wakeFd);
+		if (inotifyFd >= 0) {
+			close(inotifyFd);
+		}
+	}
+
+	StylesheetCache &
+	StylesheetCache::getDefault()
+	{
+		static StylesheetCache cache;
+		return cache;
+	}
+
+	StylesheetCache::EntryPtr
+	StylesheetCache::get(const std::filesystem::path & path)
+	{
+		const auto key = std::filesystem::absolute(path).lexically_normal();
+		const std::lock_guard guard {entriesLock};
+		auto & entry = entries[key];
+		if (!entry) {
+			entry = std::make_shared<Entry>(key);
+			// Watched before anything can load it, so no change goes unnoticed
+			if (const auto directory = key.parent_path();
+					inotifyFd >= 0 && watchedDirectories.insert(directory).second
+					&& inotify_add_watch(inotifyFd, directory.c_str(), WATCH_EVENTS) < 0) {
+				// Out of watches, or no such directory yet; the next entry there tries again
+				watchedDirectories.erase(directory);
+				entry->watched = false;
+				anyUnwatched = true;
+				wake();
+			}
+			if (!watcher.joinable()) {
+				watcher = std::jthread {[this](const std::stop_token & stop) {
+					watch(stop);
+				}};
+			}
+		}
+		return entry;
+	}
+
+	void
+	StylesheetCache::setPollInterval(const std::chrono::milliseconds interval)
+	{
+		pollInterval.store(interval);
+		wake();
+	}
+
+	void
+	StylesheetCache::wake() const
+	{
+		eventfd_write(wakeFd, 1);
+	}
+
+	void
+	StylesheetCache::refreshAll(const bool unwatchedOnly)
+	{
+		std::vector<EntryPtr> current;
+		{
+			const std::lock_guard guard {entriesLock};
+			current.reserve(entries.size());
+			for (const auto & [path, entry] : entries) {
+				if (!unwatchedOnly || !entry->watched) {
+					current.push_back(entry);
+				}
+			}
+		}
+		// Outside the lock, as parsing a stylesheet can take a while
+		for (const auto & entry : current) {
+			entry->refresh();
+		}
+	}
+
+	void
+	StylesheetCache::watch(const std::stop_token & stop)
+	{
+		const std::stop_callback onStop {stop, [this]() {
+			wake();
+		}};
+		while (!stop.stop_requested()) {
+			const auto interval = pollInterval.load();
+			const bool polling = interval.count() > 0 || inotifyFd < 0;
+			// Watching with inotify, but also polling for whatever it couldn't watch
+			const bool pollingSome = !polling && anyUnwatched.load();
+			std::array<pollfd, 2> waitFor {{{.fd = wakeFd, .events = POLLIN, .revents = 0},
+					{.fd = inotifyFd, .events = POLLIN, .revents = 0}}};
+			const auto timeout = interval.count() > 0 ? interval : FALLBACK_POLL_INTERVAL;
+			const auto ready = poll(waitFor.data(), polling ? 1 : 2,
+					polling || pollingSome ? static_cast<int>(timeout.count()) : -1);
+			if (waitFor[0].revents & POLLIN) {
+				eventfd_t count {};
+				eventfd_read(wakeFd, &count);
+			}
+			if (polling) {
+				if (ready == 0) {
+					refreshAll();
+				}
+			}
+			else if (waitFor[1].revents & POLLIN) {
+				// Which file changed doesn't matter; each entry checks its own modification time
+				std::array<char, EVENT_BUFFER> events {};
+				while (read(inotifyFd, events.data(), events.size()) > 0) { }
+				refreshAll();
+			}
+			else if (pollingSome && ready == 0) {
+				refreshAll(true);
+			}
+		}
+	}
+}
+
+PLUGIN(IceSpider::PollIntervalConfigurator, IceSpider::Configurator);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <c++11Helpers.h>
+#include <chrono>
+#include <filesystem>
+#include <libxslt/xsltInternals.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stop_token>
+#include <thread>
+#include <visibility.h>
+
+namespace IceSpider {
+	// Compiled stylesheets, shared by everything using the same file and reloaded in the background when it changes.
+	// Each new stylesheet is published with an atomic swap, so transforms in flight keep the one they started with,
+	// and fetching the current one makes no system calls.
+	class DLL_PUBLIC StylesheetCache {
+	public:
+		using StylesheetPtr = std::shared_ptr<xsltStylesheet>;
+
+		class DLL_PUBLIC Entry {
+		public:
+			explicit Entry(std::filesystem::path);
+
+			// The current stylesheet, loaded on first use; throws if it can't be
+			[[nodiscard]] StylesheetPtr get();
+			// Incremented each time a stylesheet is published
+			[[nodiscard]] unsigned int getVersion() const;
+
+			const std::filesystem::path path;
+
+		private:
+			friend class StylesheetCache;
+
+			void load();
+			// Reloads the file if it has changed since it was last loaded, keeping the old stylesheet if it won't parse
+			void refresh();
+
+			std::atomic<StylesheetPtr> stylesheet;
+			std::atomic<unsigned int> version {};
+			std::mutex loadLock;
+			std::filesystem::file_time_type writeTime {std::filesystem::file_time_type::min()};
+			// False if inotify couldn't watch its directory, so it's polled instead; guarded by entriesLock
+			bool watched {true};
+		};
+
+		using EntryPtr = std::shared_ptr<Entry>;
+
+		StylesheetCache();
+		~StylesheetCache();
+		SPECIAL_MEMBERS_DELETE(StylesheetCache);
+
+		static StylesheetCache & getDefault();
+
+		[[nodiscard]] EntryPtr get(const std::filesystem::path &);
+		// Zero, the default, watches stylesheets' directories with inotify; anything else checks each stylesheet's
+		// modification time that often instead. Each Core applies IceSpider.XsltStreamSerializer.PollInterval, if
+		// set, to the default cache.
+		void setPollInterval(std::chrono::milliseconds);
+
+		// Used if inotify isn't available, or for any stylesheet whose directory it couldn't watch
+		static constexpr std::chrono::milliseconds FALLBACK_POLL_INTERVAL {1000};
+
+	private:
+		void watch(const std::stop_token &);
+		// Every entry, or just those inotify isn't watching
+		void refreshAll(bool unwatchedOnly = false);
+		void wake() const;
+
+		std::mutex entriesLock;
+		std::map<std::filesystem::path, EntryPtr> entries;
+		std::set<std::filesystem::path> watchedDirectories;
+		std::atomic<std::chrono::milliseconds> pollInterval {};
+		// Set once any entry isn't watched, so the watcher polls for it
+		std::atomic<bool> anyUnwatched {};
+		int wakeFd;
+		// Negative if inotify isn't available
+		int inotifyFd;
+		// Started with the first entry
+		std::jthread watcher;
+	};
+}
@@ -0,0 +1,209 @@
+#include "xmlTreeBuilder.h"
+#include <Ice/Config.h>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <libxml/dict.h>
+#include <libxml/tree.h>
+#include <libxml/xmlstring.h>
+#include <limits>
+#include <memory>
+#include <slicer/metadata.h>
+#include <slicer/modelParts.h>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace IceSpider {
+	namespace {
+		constexpr std::string_view TRUE_VALUE {"true"};
+		constexpr std::string_view FALSE_VALUE {"false"};
+		constexpr std::size_t NUMBER_BUFFER = 32;
+		// Each changes the shape of Slicer's output, which isn't worth mirroring here
+		constexpr std::array<std::string_view, 5> MD_XML {
+				"xml:attribute", "xml:text", "xml:bare", "xml:attributes", "xml:elements"};
+
+		const xmlChar *
+		xmlString(const std::string_view str)
+		{
+			return reinterpret_cast<const xmlChar *>(str.data());
+		}
+
+		bool
+		xmlSpecific(const Slicer::Metadata & metadata)
+		{
+			for (const auto flag : MD_XML) {
+				if (metadata.flagSet(flag)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool
+		plain(const auto * hook)
+		{
+			return !hook || !xmlSpecific(hook->GetMetadata());
+		}
+
+		// Shared by the documents built on each thread, so each name is hashed and copied once, not once per document
+		xmlDictPtr
+		threadDict()
+		{
+			thread_local const std::unique_ptr<xmlDict, decltype(&xmlDictFree)> dict {xmlDictCreate(), &xmlDictFree};
+			return dict.get();
+		}
+
+		// Appends whatever simple value it's given to an element's text, formatted as Slicer would
+		class XmlContentTarget : public Slicer::ValueTarget {
+		public:
+			explicit XmlContentTarget(xmlNodePtr node) : node(node) { }
+
+			void
+			get(const bool & value) const override
+			{
+				add(value ? TRUE_VALUE : FALSE_VALUE);
+			}
+
+			void
+			get(const std::string & value) const override
+			{
+				add(value);
+			}
+
+#define GET(T) \
+	/* NOLINTNEXTLINE(bugprone-macro-parentheses) */ \
+	void get(const T & value) const override \
+	{ \
+		addNumber(value); \
+	}
+
+			GET(Ice::Byte);
+			GET(Ice::Short);
+			GET(Ice::Int);
+			GET(Ice::Long);
+			GET(Ice::Float);
+			GET(Ice::Double);
+#undef GET
+
+		private:
+			void
+			add(const std::string_view text) const
+			{
+				xmlNodeAddContentLen(node, xmlString(text), static_cast<int>(text.length()));
+			}
+
+			template<typename Number>
+			void
+			addNumber(const Number value) const
+			{
+				std::array<char, NUMBER_BUFFER> buffer {};
+				std::to_chars_result result {};
+				if constexpr (std::is_floating_point_v<Number>) {
+					// As boost::lexical_cast, enough digits to round trip rather than the shortest form that does
+					result = std::to_chars(buffer.begin(), buffer.end(), value, std::chars_format::general,
+							std::numeric_limits<Number>::max_digits10);
+				}
+				else {
+					result = std::to_chars(buffer.begin(), buffer.end(), value);
+				}
+				add({buffer.data(), result.ptr});
+			}
+
+			xmlNodePtr node;
+		};
+	}
+
+	XmlTreeBuilder::XmlTreeBuilder(xmlDocPtr doc) : doc(doc) { }
+
+	XmlDocPtr
+	XmlTreeBuilder::build(Slicer::ModelPartForRootParam modelPart)
+	{
+		XmlDocPtr doc {xmlNewDoc(xmlString("1.0")), &xmlFreeDoc};
+		// The document's reference is released when it's freed
+		doc->dict = threadDict();
+		xmlDictReference(doc->dict);
+		XmlTreeBuilder builder {doc.get()};
+		modelPart->OnEachChild([&builder](const auto & name, auto child, auto hook) {
+			if (!child || !child->HasValue() || !plain(hook)) {
+				builder.faithful = false;
+				return;
+			}
+			builder.addContent(builder.addElement(nullptr, name), child);
+		});
+		if (!builder.faithful) {
+			doc.reset();
+		}
+		return doc;
+	}
+
+	xmlNodePtr
+	XmlTreeBuilder::addElement(xmlNodePtr parent, const std::string & name)
+	{
+		// The node takes the dictionary's copy of the name rather than one of its own
+		auto * const node = xmlNewDocNodeEatName(doc, nullptr,
+				const_cast<xmlChar *>(xmlDictLookup(doc->dict, xmlString(name), static_cast<int>(name.length()))),
+				nullptr);
+		if (parent) {
+			xmlAddChild(parent, node);
+		}
+		else {
+			xmlDocSetRootElement(doc, node);
+		}
+		return node;
+	}
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	XmlTreeBuilder::addContent(xmlNodePtr node, const Slicer::ModelPartParam modelPart)
+	{
+		if (!faithful) {
+			return;
+		}
+		switch (modelPart->GetType()) {
+			case Slicer::ModelPartType::Simple:
+				modelPart->GetValue(XmlContentTarget {node});
+				break;
+			case Slicer::ModelPartType::Complex:
+				if (modelPart->GetTypeId()) {
+					faithful = false;
+					break;
+				}
+				modelPart->OnEachChild([this, node](const auto & name, auto child, auto hook) {
+					if (child && child->HasValue()) {
+						if (!plain(hook)) {
+							faithful = false;
+							return;
+						}
+						addContent(addElement(node, name), child);
+					}
+				});
+				break;
+			case Slicer::ModelPartType::Sequence:
+			case Slicer::ModelPartType::Dictionary:
+				addChildren(node, modelPart);
+				break;
+			case Slicer::ModelPartType::Null:
+				faithful = false;
+				break;
+		}
+	}
+
+	void
+	// NOLINTNEXTLINE(misc-no-recursion)
+	XmlTreeBuilder::addChildren(xmlNodePtr node, const Slicer::ModelPartParam modelPart)
+	{
+		if (xmlSpecific(modelPart->GetMetadata())) {
+			faithful = false;
+			return;
+		}
+		// One element per item or key/value pair, named as the model part says
+		modelPart->OnEachChild([this, node](const auto & name, auto child, auto) {
+			if (!child || !child->HasValue()) {
+				faithful = false;
+				return;
+			}
+			addContent(addElement(node, name), child);
+		});
+	}
+}
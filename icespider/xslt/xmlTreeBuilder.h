@@ -0,0 +1,30 @@
+#pragma once
+
+#include <libxml/tree.h>
+#include <memory>
+#include <slicer/modelParts.h>
+#include <string>
+#include <visibility.h>
+
+namespace IceSpider {
+	using XmlDocPtr = std::unique_ptr<xmlDoc, decltype(&xmlFreeDoc)>;
+
+	// Builds the document Slicer's XML serializer would, straight into libxml2: there's no C++ wrapper per node and
+	// each distinct element name is interned once, in a dictionary shared by every document built on the thread.
+	class DLL_PUBLIC XmlTreeBuilder {
+	public:
+		// Null if the model uses anything only Slicer's XML serializer is sure to reproduce (xml: metadata, subclass
+		// type ids, nulls), in which case the caller should use that instead
+		[[nodiscard]] static XmlDocPtr build(Slicer::ModelPartForRootParam);
+
+	private:
+		explicit XmlTreeBuilder(xmlDocPtr);
+
+		xmlNodePtr addElement(xmlNodePtr parent, const std::string & name);
+		void addContent(xmlNodePtr, Slicer::ModelPartParam);
+		void addChildren(xmlNodePtr, Slicer::ModelPartParam);
+
+		xmlDocPtr doc;
+		bool faithful {true};
+	};
+}
@@ -1,5 +1,6 @@
 #include "xsltStreamSerializer.h"
-#include <filesystem>
+#include "xmlTreeBuilder.h"
+#include <cstddef>
 #include <libxml++/document.h>
 #include <libxml++/exceptions/exception.h>
 #include <libxml/HTMLtree.h>
@@ -13,60 +14,71 @@
 #include <slicer/modelParts.h>
 #include <slicer/serializer.h>
 #include <slicer/xml/serializer.h>
+#include <string>
+#include <utility>
 
 namespace IceSpider {
 	namespace {
-		int
-		xmlstrmclosecallback(void * context)
-		{
-			static_cast<std::ostream *>(context)->flush();
-			return 0;
-		}
+		// Above this, a thread's output buffer is released after use rather than kept for its next transform
+		constexpr std::string::size_type MAX_RETAINED_OUTPUT = 1024UL * 1024;
+
+		// Each transform's output is gathered here, then written to the request stream in one go
+		thread_local std::string output;
 
 		int
-		xmlstrmwritecallback(void * context, const char * buffer, int len)
+		xmlbufwritecallback(void * context, const char * buffer, int len)
 		{
-			static_cast<std::ostream *>(context)->write(buffer, len);
+			static_cast<std::string *>(context)->append(buffer, static_cast<std::string::size_type>(len));
 			return len;
 		}
 	}
 
-	XsltStreamSerializer::IceSpiderFactory::IceSpiderFactory(const char * path) :
-		stylesheetPath(path), stylesheetWriteTime(std::filesystem::file_time_type::min()), stylesheet(nullptr, nullptr)
+	XsltStreamSerializer::IceSpiderFactory::IceSpiderFactory(const char * path, const std::size_t cacheBytes) :
+		stylesheet(StylesheetCache::getDefault().get(path)),
+		cache(cacheBytes ? std::make_shared<RenderCache>(cacheBytes) : nullptr)
 	{
 	}
 
 	Slicer::SerializerPtr
 	XsltStreamSerializer::IceSpiderFactory::create(std::ostream & strm) const
 	{
-		auto newMtime = std::filesystem::last_write_time(stylesheetPath);
-		if (newMtime != stylesheetWriteTime) {
-			stylesheet = {xsltParseStylesheetFile(reinterpret_cast<const unsigned char *>(stylesheetPath.c_str())),
-					xsltFreeStylesheet};
-			if (!stylesheet) {
-				throw xmlpp::exception("Failed to load stylesheet");
-			}
-			stylesheetWriteTime = newMtime;
-		}
-		return std::make_shared<XsltStreamSerializer>(strm, stylesheet.get());
+		// Read first, as it's incremented after a reload is published, so output is never cached under a version
+		// newer than the stylesheet which rendered it
+		const auto version = stylesheet->getVersion();
+		// Serializers share ownership, so a reload never frees a stylesheet mid transform
+		return std::make_shared<XsltStreamSerializer>(strm, stylesheet->get(), cache, version);
 	}
 
-	XsltStreamSerializer::XsltStreamSerializer(std::ostream & strm, xsltStylesheet * stylesheet) :
-		strm(strm), stylesheet(stylesheet)
+	XsltStreamSerializer::XsltStreamSerializer(std::ostream & strm, std::shared_ptr<xsltStylesheet> stylesheet,
+			std::shared_ptr<RenderCache> cache, const unsigned int stylesheetVersion) :
+		strm(strm), stylesheet(std::move(stylesheet)), cache(std::move(cache)), stylesheetVersion(stylesheetVersion)
 	{
 	}
 
 	void
 	XsltStreamSerializer::Serialize(Slicer::ModelPartForRootParam modelPart)
 	{
-		Slicer::XmlDocumentSerializer::Serialize(modelPart);
-		const auto result = std::unique_ptr<xmlDoc, decltype(&xmlFreeDoc)> {
-				xsltApplyStylesheet(stylesheet, doc.cobj(), nullptr), &xmlFreeDoc};
+		std::string key;
+		if (cache) {
+			key = RenderCache::key(modelPart, stylesheetVersion);
+			if (const auto cached = cache->find(key)) {
+				strm.write(cached->data(), static_cast<std::streamsize>(cached->length())).flush();
+				return;
+			}
+		}
+		// Built directly where possible; otherwise by Slicer, through libxml++
+		const auto input = XmlTreeBuilder::build(modelPart);
+		if (!input) {
+			Slicer::XmlDocumentSerializer::Serialize(modelPart);
+		}
+		const auto result = XmlDocPtr {
+				xsltApplyStylesheet(stylesheet.get(), input ? input.get() : doc.cobj(), nullptr), &xmlFreeDoc};
 		if (!result) {
 			throw xmlpp::exception("Failed to apply XSL transform");
 		}
+		output.clear();
 		auto buf = std::unique_ptr<xmlOutputBuffer, decltype(&xmlOutputBufferClose)> {
-				xmlOutputBufferCreateIO(xmlstrmwritecallback, xmlstrmclosecallback, &strm, nullptr),
+				xmlOutputBufferCreateIO(xmlbufwritecallback, nullptr, &output, nullptr),
 				&xmlOutputBufferClose};
 		if (xmlStrcmp(stylesheet->method, reinterpret_cast<const unsigned char *>("html")) == 0) {
 			htmlDocContentDumpFormatOutput(
@@ -75,5 +87,14 @@ namespace IceSpider {
 		else {
 			xmlSaveFormatFileTo(buf.release(), result.get(), reinterpret_cast<const char *>(stylesheet->encoding), 0);
 		}
+		// Flushes anything libxml2 still holds into output
+		buf.reset();
+		strm.write(output.data(), static_cast<std::streamsize>(output.length())).flush();
+		if (cache) {
+			cache->insert(std::move(key), output);
+		}
+		if (output.capacity() > MAX_RETAINED_OUTPUT) {
+			std::string {}.swap(output);
+		}
 	}
 }
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <c++11Helpers.h>
-#include <filesystem>
+#include "renderCache.h"
+#include "stylesheetCache.h"
+#include <cstddef>
 #include <iosfwd>
 #include <libxslt/xsltInternals.h>
 #include <memory>
@@ -15,22 +16,28 @@ namespace IceSpider {
 	public:
 		class IceSpiderFactory : public Slicer::StreamSerializerFactory {
 		public:
-			explicit IceSpiderFactory(const char *);
+			// A non-zero cacheBytes keeps up to that much of this route's output, so a model seen before, rendered
+			// with the same stylesheet, is served without being transformed again
+			explicit IceSpiderFactory(const char *, std::size_t cacheBytes = 0);
 
 			Slicer::SerializerPtr create(std::ostream &) const override;
 
 		private:
-			std::filesystem::path stylesheetPath;
-			mutable std::filesystem::file_time_type stylesheetWriteTime;
-			mutable std::unique_ptr<xsltStylesheet, decltype(&xsltFreeStylesheet)> stylesheet;
+			// Shared with every other route using the same file
+			StylesheetCache::EntryPtr stylesheet;
+			std::shared_ptr<RenderCache> cache;
 		};
 
-		XsltStreamSerializer(std::ostream &, xsltStylesheet *);
+		// stylesheetVersion is the version of stylesheet, or any earlier one, that output is cached under
+		XsltStreamSerializer(std::ostream &, std::shared_ptr<xsltStylesheet>, std::shared_ptr<RenderCache> = {},
+				unsigned int stylesheetVersion = 0);
 
 		void Serialize(Slicer::ModelPartForRootParam modelPart) override;
 
 	protected:
 		std::ostream & strm;
-		xsltStylesheet * stylesheet;
+		std::shared_ptr<xsltStylesheet> stylesheet;
+		std::shared_ptr<RenderCache> cache;
+		unsigned int stylesheetVersion;
 	};
 }